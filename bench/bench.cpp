@@ -0,0 +1,464 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <mem/pattern.h>
+
+#include <mem/auto_scanner.h>
+#include <mem/boyer_moore_scanner.h>
+#include <mem/byte_frequencies.h>
+#include <mem/simd_scanner.h>
+
+#include <mem/cmd_param.h>
+#include <mem/cmd_param-inl.h>
+
+#if defined(__unix__)
+#    include <mem/file_module.h>
+#    include <mem/protect.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+mem::cmd_param bench_format {"format"};
+mem::cmd_param bench_filter {"filter"};
+mem::cmd_param bench_min_time {"min-time"};
+mem::cmd_param bench_size {"size"};
+
+struct bench_input
+{
+    std::string name;
+    mem::region range;
+    std::vector<mem::byte> storage;
+#if defined(__unix__)
+    std::shared_ptr<mem::file_module> file;
+#endif
+};
+
+struct bench_pattern
+{
+    std::string name;
+    mem::pattern pattern;
+};
+
+struct bench_engine
+{
+    std::string name;
+    std::function<std::size_t(mem::region)> scan;
+};
+
+struct bench_result
+{
+    std::string input;
+    std::string engine;
+    std::string pattern;
+    std::size_t size;
+    std::size_t matches;
+    std::size_t iterations;
+    double seconds;
+};
+
+static std::vector<mem::byte> make_random(std::size_t size)
+{
+    std::vector<mem::byte> result(size);
+
+    std::uint32_t state = 0x12345678;
+
+    for (mem::byte& value : result)
+    {
+        state = (state * 1103515245) + 12345;
+        value = static_cast<mem::byte>(state >> 16);
+    }
+
+    return result;
+}
+
+static std::vector<mem::byte> make_zero_heavy(std::size_t size)
+{
+    std::vector<mem::byte> result = make_random(size);
+
+    // Roughly 1 in 8 bytes is non-zero, like padding heavy data sections
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (result[i] & 0x07)
+            result[i] = 0x00;
+    }
+
+    return result;
+}
+
+#if defined(__unix__)
+struct find_library_query
+{
+    const char* name;
+    std::string result;
+};
+
+static int find_library_callback(mem::region_info* region, void* data)
+{
+    find_library_query* query = static_cast<find_library_query*>(data);
+
+    if (region->path_name && std::strstr(region->path_name, query->name))
+    {
+        query->result = region->path_name;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+// Finds the path of a library mapped into this process, then maps it again from disk
+static bool load_library(const char* name, const char* pattern, bench_input& input)
+{
+    find_library_query query {pattern, {}};
+
+    if (!mem::iter_proc_maps(&find_library_callback, &query))
+        return false;
+
+    std::shared_ptr<mem::file_module> file = std::make_shared<mem::file_module>(query.result.c_str());
+
+    if (!*file)
+        return false;
+
+    input.name = name;
+    input.range = *file;
+    input.file = file;
+
+    return true;
+}
+#endif
+
+static std::vector<bench_input> make_inputs(std::size_t size)
+{
+    std::vector<bench_input> inputs;
+
+    bench_input input;
+
+    input.name = "random";
+    input.storage = make_random(size);
+    input.range = mem::region(input.storage.data(), input.storage.size());
+    inputs.push_back(std::move(input));
+
+    input = bench_input();
+    input.name = "zero_heavy";
+    input.storage = make_zero_heavy(size);
+    input.range = mem::region(input.storage.data(), input.storage.size());
+    inputs.push_back(std::move(input));
+
+#if defined(__unix__)
+    input = bench_input();
+
+    if (load_library("libc", "libc.so", input))
+        inputs.push_back(std::move(input));
+
+    input = bench_input();
+
+    if (load_library("ld.so", "ld-linux", input))
+        inputs.push_back(std::move(input));
+#endif
+
+    return inputs;
+}
+
+static void get_byte_ranks(mem::region range, mem::byte& common, mem::byte& rare)
+{
+    std::size_t counts[256] {};
+
+    const mem::byte* data = range.start.as<const mem::byte*>();
+
+    for (std::size_t i = 0; i < range.size; ++i)
+        ++counts[data[i]];
+
+    common = 0x00;
+    rare = 0x00;
+
+    for (std::size_t i = 1; i < 256; ++i)
+    {
+        if (counts[i] > counts[common])
+            common = static_cast<mem::byte>(i);
+
+        if (counts[i] < counts[rare])
+            rare = static_cast<mem::byte>(i);
+    }
+}
+
+static std::vector<bench_pattern> make_patterns(mem::region range)
+{
+    std::vector<bench_pattern> patterns;
+
+    // Patterns are sliced from the middle of the input, so each one has at least one match
+    const mem::byte* sample = range.start.add(range.size / 2).as<const mem::byte*>();
+
+    auto add = [&](const char* name, std::size_t length, std::function<mem::byte(std::size_t)> mask) {
+        std::vector<mem::byte> masks(length);
+
+        for (std::size_t i = 0; i < length; ++i)
+            masks[i] = mask(i);
+
+        patterns.push_back({name, mem::pattern(sample, masks.data(), length)});
+    };
+
+    add("solid_4", 4, [](std::size_t) -> mem::byte { return 0xFF; });
+    add("solid_16", 16, [](std::size_t) -> mem::byte { return 0xFF; });
+    add("solid_64", 64, [](std::size_t) -> mem::byte { return 0xFF; });
+    add("wildcard_25_16", 16, [](std::size_t i) -> mem::byte { return (i % 4 == 1) ? 0x00 : 0xFF; });
+    add("wildcard_50_16", 16, [](std::size_t i) -> mem::byte { return (i % 2 == 1) ? 0x00 : 0xFF; });
+    add("nibble_8", 8, [](std::size_t i) -> mem::byte { return (i % 2 == 1) ? 0xF0 : 0xFF; });
+    add("no_anchor_8", 8, [](std::size_t i) -> mem::byte { return (i % 2 == 1) ? 0xF0 : 0x0F; });
+
+    mem::byte common = 0;
+    mem::byte rare = 0;
+
+    get_byte_ranks(range, common, rare);
+
+    const mem::byte common_bytes[8] {common, common, common, common, common, common, common, rare};
+    const mem::byte common_masks[8] {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+    patterns.push_back({"common_anchor_8", mem::pattern(common_bytes, common_masks, 8)});
+
+    const mem::byte rare_bytes[8] {rare, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, common};
+    const mem::byte rare_masks[8] {0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+    patterns.push_back({"rare_anchor_8", mem::pattern(rare_bytes, rare_masks, 8)});
+
+    return patterns;
+}
+
+template <typename Scanner>
+static bench_engine make_engine(const char* name, const std::shared_ptr<Scanner>& scanner)
+{
+    return {name, [scanner](mem::region range) { return scanner->count(range); }};
+}
+
+static std::vector<bench_engine> make_engines(const mem::pattern& pattern, const mem::byte* frequencies)
+{
+    std::vector<bench_engine> engines;
+
+    engines.push_back(make_engine("simd_scanner", std::make_shared<mem::simd_scanner>(pattern)));
+    engines.push_back(make_engine("simd_scanner_single",
+        std::make_shared<mem::simd_scanner>(pattern, mem::simd_scanner::default_frequencies(), false)));
+    engines.push_back(make_engine("simd_scanner_profiled", std::make_shared<mem::simd_scanner>(pattern, frequencies)));
+    engines.push_back(make_engine("boyer_moore_scanner", std::make_shared<mem::boyer_moore_scanner>(pattern)));
+    engines.push_back(make_engine("auto_scanner", std::make_shared<mem::auto_scanner>(pattern)));
+
+    return engines;
+}
+
+// Many scanners kept alive and run over the same small chunks, like a signature set scanned window by window
+template <typename Scanner>
+struct interleaved_scanners
+{
+    std::vector<mem::pattern> patterns;
+    std::vector<Scanner> scanners;
+
+    interleaved_scanners(mem::region range, std::size_t count)
+    {
+        patterns.reserve(count);
+        scanners.reserve(count);
+
+        std::uint32_t state = 0x9E3779B9;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            state = (state * 1103515245) + 12345;
+
+            const std::size_t length = 32;
+            const std::size_t offset = state % (range.size - length);
+
+            std::vector<mem::byte> masks(length, 0xFF);
+
+            if (i % 2)
+            {
+                for (std::size_t j = 3; j < length; j += 5)
+                    masks[j] = 0xF0;
+            }
+
+            patterns.emplace_back(range.start.add(offset).as<const void*>(), masks.data(), length);
+            scanners.emplace_back(patterns.back());
+        }
+    }
+
+    std::size_t operator()(mem::region range) const
+    {
+        const std::size_t chunk_size = 0x1000;
+
+        std::size_t count = 0;
+
+        for (std::size_t i = 0; i < range.size; i += chunk_size)
+        {
+            const mem::region chunk(range.start.add(i), std::min(chunk_size, range.size - i));
+
+            for (const Scanner& scanner : scanners)
+                count += scanner.count(chunk);
+        }
+
+        return count;
+    }
+};
+
+static bench_result run_bench(const std::string& input, const std::string& engine, const std::string& pattern,
+    mem::region range, const std::function<std::size_t(mem::region)>& func, double min_time)
+{
+    using clock = std::chrono::steady_clock;
+
+    bench_result result {input, engine, pattern, range.size, func(range), 0, 0.0};
+
+    const clock::time_point start = clock::now();
+
+    do
+    {
+        volatile std::size_t matches = func(range);
+        (void) matches;
+
+        ++result.iterations;
+        result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    } while (result.seconds < min_time);
+
+    return result;
+}
+
+static void print_results(const std::vector<bench_result>& results, bool json)
+{
+    if (json)
+        std::printf("[\n");
+    else
+        std::printf("input,engine,pattern,bytes,matches,iterations,seconds,gb_per_s,ns_per_match\n");
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const bench_result& result = results[i];
+
+        const double per_iteration = result.seconds / static_cast<double>(result.iterations);
+        const double gb_per_s = static_cast<double>(result.size) / per_iteration / 1e9;
+        const double ns_per_match = result.matches ? (per_iteration * 1e9 / static_cast<double>(result.matches)) : 0.0;
+
+        if (json)
+        {
+            std::printf("  {\"input\": \"%s\", \"engine\": \"%s\", \"pattern\": \"%s\", \"bytes\": %zu, "
+                        "\"matches\": %zu, \"iterations\": %zu, \"seconds\": %.6f, \"gb_per_s\": %.4f, "
+                        "\"ns_per_match\": %.2f}%s\n",
+                result.input.c_str(), result.engine.c_str(), result.pattern.c_str(), result.size, result.matches,
+                result.iterations, result.seconds, gb_per_s, ns_per_match, (i + 1 < results.size()) ? "," : "");
+        }
+        else
+        {
+            std::printf("%s,%s,%s,%zu,%zu,%zu,%.6f,%.4f,%.2f\n", result.input.c_str(), result.engine.c_str(),
+                result.pattern.c_str(), result.size, result.matches, result.iterations, result.seconds, gb_per_s,
+                ns_per_match);
+        }
+    }
+
+    if (json)
+        std::printf("]\n");
+}
+
+int main(int argc, const char** argv)
+{
+    mem::cmd_param::init(argc, argv);
+
+    const char* format = bench_format.get();
+    const char* filter = bench_filter.get();
+
+    if (!filter)
+        filter = "";
+
+    const double min_time = bench_min_time.get_or<double>(0.2);
+    const std::size_t size = bench_size.get_or<std::size_t>(16 * 1024 * 1024);
+
+    std::vector<bench_result> results;
+
+    for (const bench_input& input : make_inputs(size))
+    {
+        mem::byte common = 0;
+        mem::byte rare = 0;
+
+        get_byte_ranks(input.range, common, rare);
+
+        const mem::byte values[2] {common, rare};
+        const char* const value_names[2] {"common_byte", "rare_byte"};
+
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            const std::string name = std::string("find_byte/") + value_names[i];
+
+            if (!std::strstr((input.name + "/" + name).c_str(), filter))
+                continue;
+
+            const mem::byte value = values[i];
+
+            results.push_back(run_bench(input.name, "find_byte", value_names[i], input.range,
+                [value](mem::region range) {
+                    std::size_t count = 0;
+
+                    const mem::byte* current = range.start.as<const mem::byte*>();
+                    const mem::byte* const end = current + range.size;
+
+                    while ((current = mem::find_byte(current, value, static_cast<std::size_t>(end - current))) != end)
+                    {
+                        ++count;
+                        ++current;
+                    }
+
+                    return count;
+                },
+                min_time));
+        }
+
+        const std::size_t scanner_count = 512;
+        const std::string interleaved_name = "interleaved_x" + std::to_string(scanner_count);
+
+        if (std::strstr((input.name + "/boyer_moore_scanner/" + interleaved_name).c_str(), filter))
+        {
+            // Limit the input, since every byte is scanned once per scanner
+            const mem::region range(input.range.start, std::min<std::size_t>(input.range.size, 0x100000));
+
+            std::shared_ptr<interleaved_scanners<mem::boyer_moore_scanner>> scanners =
+                std::make_shared<interleaved_scanners<mem::boyer_moore_scanner>>(range, scanner_count);
+
+            bench_result result = run_bench(input.name, "boyer_moore_scanner", interleaved_name, range,
+                [scanners](mem::region chunk) { return (*scanners)(chunk); }, min_time);
+
+            result.size *= scanner_count;
+
+            results.push_back(result);
+        }
+
+        const mem::frequency_table frequencies(input.range);
+
+        for (const bench_pattern& pattern : make_patterns(input.range))
+        {
+            for (const bench_engine& engine : make_engines(pattern.pattern, frequencies.data()))
+            {
+                if (!std::strstr((input.name + "/" + engine.name + "/" + pattern.name).c_str(), filter))
+                    continue;
+
+                results.push_back(
+                    run_bench(input.name, engine.name, pattern.name, input.range, engine.scan, min_time));
+            }
+        }
+    }
+
+    print_results(results, format && !std::strcmp(format, "json"));
+
+    return 0;
+}
@@ -24,10 +24,16 @@
 
 #if defined(MEM_ARCH_X86) || defined(MEM_ARCH_X86_64)
 #    if defined(_MSC_VER)
+#        include <immintrin.h>
 #        include <intrin.h>
 #        pragma intrinsic(__rdtsc)
+#        pragma intrinsic(__cpuidex)
 #        pragma intrinsic(_BitScanForward)
+#        if defined(MEM_ARCH_X86_64)
+#            pragma intrinsic(_BitScanForward64)
+#        endif
 #    else
+#        include <cpuid.h>
 #        include <x86intrin.h>
 #    endif
 #endif
@@ -54,6 +60,127 @@ namespace mem
         return result;
 #    endif
     }
+
+    MEM_STRONG_INLINE unsigned int bsf(std::uint64_t x) noexcept
+    {
+#    if defined(__GNUC__) && ((__GNUC__ >= 4) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 4)))
+        return static_cast<unsigned int>(__builtin_ctzll(x));
+#    elif defined(_MSC_VER) && defined(MEM_ARCH_X86_64)
+        unsigned long result;
+        _BitScanForward64(&result, x);
+        return static_cast<unsigned int>(result);
+#    else
+        const unsigned int low = static_cast<unsigned int>(x);
+
+        return low ? bsf(low) : (bsf(static_cast<unsigned int>(x >> 32)) + 32);
+#    endif
+    }
+
+    MEM_STRONG_INLINE unsigned int bsr(unsigned int x) noexcept
+    {
+#    if defined(__GNUC__) && ((__GNUC__ >= 4) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 4)))
+        return static_cast<unsigned int>(31 ^ __builtin_clz(x));
+#    elif defined(_MSC_VER)
+        unsigned long result;
+        _BitScanReverse(&result, static_cast<unsigned long>(x));
+        return static_cast<unsigned int>(result);
+#    else
+        unsigned int result;
+        asm("bsr %1, %0" : "=r"(result) : "rm"(x));
+        return result;
+#    endif
+    }
+
+    MEM_STRONG_INLINE unsigned int bsr(std::uint64_t x) noexcept
+    {
+#    if defined(__GNUC__) && ((__GNUC__ >= 4) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 4)))
+        return static_cast<unsigned int>(63 ^ __builtin_clzll(x));
+#    elif defined(_MSC_VER) && defined(MEM_ARCH_X86_64)
+        unsigned long result;
+        _BitScanReverse64(&result, x);
+        return static_cast<unsigned int>(result);
+#    else
+        const unsigned int high = static_cast<unsigned int>(x >> 32);
+
+        return high ? (bsr(high) + 32) : bsr(static_cast<unsigned int>(x));
+#    endif
+    }
+
+    MEM_STRONG_INLINE void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) noexcept
+    {
+#    if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+
+        for (int i = 0; i < 4; ++i)
+            regs[i] = static_cast<unsigned int>(info[i]);
+#    else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#    endif
+    }
+
+    MEM_STRONG_INLINE std::uint64_t xgetbv(unsigned int index) noexcept
+    {
+#    if defined(_MSC_VER)
+        return _xgetbv(index);
+#    else
+        unsigned int eax, edx;
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+        return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#    endif
+    }
+
+    enum class simd_level : int
+    {
+        none,
+        sse2,
+        avx2,
+        avx512bw,
+    };
+
+    inline simd_level detect_simd_level() noexcept
+    {
+        unsigned int regs[4] {};
+
+        cpuid(0, 0, regs);
+
+        const unsigned int max_leaf = regs[0];
+
+        if (max_leaf < 1)
+            return simd_level::none;
+
+        cpuid(1, 0, regs);
+
+        const unsigned int features = regs[3];
+        const unsigned int ext_features = regs[2];
+
+        if (!(features & (1u << 26))) // SSE2
+            return simd_level::none;
+
+        if (!(ext_features & (1u << 27)) || (max_leaf < 7)) // OSXSAVE
+            return simd_level::sse2;
+
+        const std::uint64_t xcr0 = xgetbv(0);
+
+        cpuid(7, 0, regs);
+
+        const unsigned int leaf7_features = regs[1];
+
+        if (((xcr0 & 0xE6) == 0xE6) && (leaf7_features & (1u << 16)) && (leaf7_features & (1u << 30))) // AVX512F/BW
+            return simd_level::avx512bw;
+
+        if (((xcr0 & 0x06) == 0x06) && (leaf7_features & (1u << 5))) // AVX2
+            return simd_level::avx2;
+
+        return simd_level::sse2;
+    }
+
+    inline simd_level get_simd_level() noexcept
+    {
+        static const simd_level level = detect_simd_level();
+
+        return level;
+    }
 #endif
 } // namespace mem
 
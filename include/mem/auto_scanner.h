@@ -0,0 +1,157 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_AUTO_SCANNER_BRICK_H
+#define MEM_AUTO_SCANNER_BRICK_H
+
+#include "boyer_moore_scanner.h"
+#include "pattern.h"
+#include "simd_scanner.h"
+
+namespace mem
+{
+    enum class scan_engine
+    {
+        simd,
+        boyer_moore,
+    };
+
+    class auto_scanner : public scanner_base<auto_scanner>
+    {
+    private:
+        simd_scanner simd_ {};
+        boyer_moore_scanner boyer_moore_ {};
+        scan_engine engine_ {scan_engine::simd};
+
+    public:
+        // Thresholds measured with mem_bench: simd_scanner wins unless every solid byte is among the
+        // most common bytes, where Boyer-Moore skips on the longest solid run instead.
+        static constexpr const std::size_t default_min_run {4};
+        static constexpr const byte default_min_rank {0xFE};
+
+        auto_scanner() = default;
+
+        auto_scanner(pattern_view pattern);
+        auto_scanner(pattern_view pattern, const byte* frequencies);
+
+        auto_scanner(const simd_scanner& simd) noexcept;
+        auto_scanner(const boyer_moore_scanner& boyer_moore);
+
+        static scan_engine select_engine(pattern_view pattern, const byte* frequencies);
+
+        using scanner_base<auto_scanner>::operator();
+
+        template <typename Func>
+        pointer operator()(region range, Func func) const;
+
+        pointer scan(region range) const;
+        pointer rscan(region range) const;
+
+        pattern_view get_pattern() const noexcept;
+
+        scan_engine engine() const noexcept;
+    };
+
+    constexpr const std::size_t auto_scanner::default_min_run;
+    constexpr const byte auto_scanner::default_min_rank;
+
+    inline auto_scanner::auto_scanner(pattern_view _pattern)
+        : auto_scanner(_pattern, simd_scanner::default_frequencies())
+    {}
+
+    inline auto_scanner::auto_scanner(pattern_view _pattern, const byte* frequencies)
+        : engine_(select_engine(_pattern, frequencies))
+    {
+        switch (engine_)
+        {
+            case scan_engine::simd: simd_ = simd_scanner(_pattern, frequencies); break;
+            case scan_engine::boyer_moore: boyer_moore_ = boyer_moore_scanner(_pattern); break;
+        }
+    }
+
+    MEM_STRONG_INLINE auto_scanner::auto_scanner(const simd_scanner& simd) noexcept
+        : simd_(simd)
+        , engine_(scan_engine::simd)
+    {}
+
+    inline auto_scanner::auto_scanner(const boyer_moore_scanner& boyer_moore)
+        : boyer_moore_(boyer_moore)
+        , engine_(scan_engine::boyer_moore)
+    {}
+
+    inline scan_engine auto_scanner::select_engine(pattern_view _pattern, const byte* frequencies)
+    {
+        const std::size_t skip_pos = _pattern.get_skip_pos(frequencies);
+
+        // Without a solid byte to search for, both fall back to checking every position
+        if (skip_pos == SIZE_MAX)
+            return scan_engine::boyer_moore;
+
+        if (frequencies[_pattern.bytes()[skip_pos]] < default_min_rank)
+            return scan_engine::simd;
+
+        std::size_t run_length = 0;
+        _pattern.get_longest_run(run_length);
+
+        if (run_length < default_min_run)
+            return scan_engine::simd;
+
+        return scan_engine::boyer_moore;
+    }
+
+    template <typename Func>
+    MEM_STRONG_INLINE pointer auto_scanner::operator()(region range, Func func) const
+    {
+        if (engine_ == scan_engine::boyer_moore)
+            return boyer_moore_(range, func);
+
+        return simd_(range, func);
+    }
+
+    MEM_STRONG_INLINE pointer auto_scanner::scan(region range) const
+    {
+        if (engine_ == scan_engine::boyer_moore)
+            return boyer_moore_.scan(range);
+
+        return simd_.scan(range);
+    }
+
+    MEM_STRONG_INLINE pointer auto_scanner::rscan(region range) const
+    {
+        if (engine_ == scan_engine::boyer_moore)
+            return boyer_moore_.rscan(range);
+
+        return simd_.rscan(range);
+    }
+
+    MEM_STRONG_INLINE pattern_view auto_scanner::get_pattern() const noexcept
+    {
+        if (engine_ == scan_engine::boyer_moore)
+            return boyer_moore_.get_pattern();
+
+        return simd_.get_pattern();
+    }
+
+    MEM_STRONG_INLINE scan_engine auto_scanner::engine() const noexcept
+    {
+        return engine_;
+    }
+} // namespace mem
+
+#endif // MEM_AUTO_SCANNER_BRICK_H
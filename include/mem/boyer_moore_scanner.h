@@ -22,133 +22,431 @@
 
 #include "pattern.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 namespace mem
 {
     class boyer_moore_scanner : public scanner_base<boyer_moore_scanner>
     {
     private:
-        const pattern* pattern_ {nullptr};
+        pattern_view pattern_ {};
 
         // Boyer–Moore + Boyer–Moore–Horspool Implementation
-        std::vector<std::size_t> bc_skips_ {};
-        std::vector<std::size_t> gs_skips_ {};
+        // Skips are clamped to the entry width, which only makes them more conservative
+        union skip_table
+        {
+            std::uint8_t narrow[256];
+            std::uint16_t wide[256];
+        };
+
+        // The mirrored table for reverse scans, which is only built once something scans backwards.
+        // It is filled in by const methods: once ready_ is set it never changes, so only the first build takes a lock.
+        class lazy_reverse_skips
+        {
+        private:
+            mutable std::atomic<bool> ready_ {false};
+            mutable std::shared_ptr<const void> skips_ {}; // null if every position is checked
+            mutable std::size_t skip_pos_ {SIZE_MAX};
+
+            static std::mutex& get_mutex();
+
+        public:
+            lazy_reverse_skips() = default;
+
+            lazy_reverse_skips(const lazy_reverse_skips& other);
+            lazy_reverse_skips& operator=(const lazy_reverse_skips& other);
+
+            // Builder sets skip_pos and returns the table, or null if every position should be checked
+            template <typename Builder>
+            const void* get(std::size_t& skip_pos, Builder builder) const;
+
+            void set(std::shared_ptr<const void> skips, std::size_t skip_pos);
+        };
+
+        // Built tables are owned and shared between copies. Precomputed tables are aliased without being owned.
+        std::shared_ptr<const void> bc_skips_ {}; // null if every position is checked
+        std::shared_ptr<const std::uint16_t> gs_skips_ {};
+        lazy_reverse_skips rbc_skips_ {};
 
         std::size_t skip_pos_ {SIZE_MAX};
+        std::size_t min_bc_skip_ {0};
+
+        bool wide_bc_skips_ {false};
+
+        std::shared_ptr<const void> make_skips(const std::size_t* skips) const;
 
-        std::size_t get_longest_run(std::size_t& length) const;
+        const void* get_rbc_skips(std::size_t& skip_pos) const;
+
+        std::size_t get_probe_pos(std::size_t& average_skip, std::size_t* skips, bool reverse) const;
+
+        std::shared_ptr<const std::uint16_t> get_gs_skips() const;
 
         bool is_prefix(std::size_t pos) const;
         std::size_t get_suffix_length(std::size_t pos) const;
 
+        template <typename T, typename Func>
+        pointer scan_skips(region range, const T* skips, Func& func) const;
+
+        template <typename T>
+        pointer rscan_skips(region range, const T* skips, std::size_t skip_pos) const;
+
     public:
+        // The precomputed skip tables, such as those stored in a signature_db. Unused tables are null.
+        struct tables
+        {
+            const void* bc_skips;          // 256 entries, of std::uint16_t if wide, else std::uint8_t
+            const void* rbc_skips;         // 256 entries, as above
+            const std::uint16_t* gs_skips; // trimmed_size() entries
+            std::size_t skip_pos;
+            std::size_t rskip_pos;
+            bool wide;
+        };
+
         boyer_moore_scanner() = default;
 
-        boyer_moore_scanner(const pattern& pattern);
-        boyer_moore_scanner(const pattern& pattern, std::size_t min_bc_skip, std::size_t min_gs_skip);
+        boyer_moore_scanner(pattern_view pattern);
+        boyer_moore_scanner(pattern_view pattern, std::size_t min_bc_skip, std::size_t min_gs_skip);
+
+        // References the tables without copying them or allocating, so they must outlive the scanner
+        boyer_moore_scanner(pattern_view pattern, const tables& _tables);
+
+        // Builds the reverse table if no rscan has yet
+        tables get_tables() const;
+
+        using scanner_base<boyer_moore_scanner>::operator();
+
+        // Calls func with each match until it returns true, without restarting the scan after each match
+        template <typename Func>
+        pointer operator()(region range, Func func) const;
 
         pointer scan(region range) const;
+        pointer rscan(region range) const;
+
+        pattern_view get_pattern() const noexcept;
     };
 
     static constexpr const std::size_t default_min_bc_skip {5};
     static constexpr const std::size_t default_min_gs_skip {25};
 
-    inline boyer_moore_scanner::boyer_moore_scanner(const pattern& _pattern)
+    inline boyer_moore_scanner::boyer_moore_scanner(pattern_view _pattern)
         : boyer_moore_scanner(_pattern, default_min_bc_skip, default_min_gs_skip)
     {}
 
     inline boyer_moore_scanner::boyer_moore_scanner(
-        const pattern& _pattern, std::size_t min_bc_skip, std::size_t min_gs_skip)
-        : pattern_(&_pattern)
+        pattern_view _pattern, std::size_t min_bc_skip, std::size_t min_gs_skip)
+        : pattern_(_pattern)
+        , min_bc_skip_(min_bc_skip)
     {
-        std::size_t max_skip = 0;
-        std::size_t skip_pos = get_longest_run(max_skip);
+        const byte* const bytes = pattern_.bytes();
+        const std::size_t trimmed_size = pattern_.trimmed_size();
+
+        if ((min_bc_skip == 0) || (trimmed_size == 0))
+            return;
 
-        const byte* const bytes = pattern_->bytes();
-        const std::size_t trimmed_size = pattern_->trimmed_size();
+        const std::size_t last = trimmed_size - 1;
+
+        std::size_t skips[256];
+        std::size_t average_skip = 0;
 
-        if ((min_bc_skip > 0) && (max_skip >= min_bc_skip))
+        wide_bc_skips_ = trimmed_size > UINT8_MAX;
+
+        if (!pattern_.needs_masks() && (min_gs_skip > 0) && (trimmed_size >= min_gs_skip))
         {
-            bc_skips_.resize(256, max_skip);
-            skip_pos_ = skip_pos + max_skip - 1;
+            std::fill(skips, skips + 256, trimmed_size);
+
+            for (std::size_t i = 0; i < last; ++i)
+                skips[bytes[i]] = last - i;
 
-            for (std::size_t i = skip_pos, last = skip_pos + max_skip - 1; i < last; ++i)
-                bc_skips_[bytes[i]] = last - i;
+            bc_skips_ = make_skips(skips);
+            skip_pos_ = last;
+
+            gs_skips_ = get_gs_skips();
+        }
+        else
+        {
+            // Each skip is a dependent load, so short average skips are slower than checking every position
+            std::size_t skip_pos = get_probe_pos(average_skip, skips, false);
 
-            if ((skip_pos == 0) && (max_skip == trimmed_size) && (min_gs_skip > 0) && (max_skip >= min_gs_skip))
+            if (average_skip >= min_bc_skip)
             {
-                gs_skips_.resize(trimmed_size);
+                bc_skips_ = make_skips(skips);
+                skip_pos_ = skip_pos;
+            }
+        }
+    }
 
-                const std::size_t last = trimmed_size - 1;
+    inline boyer_moore_scanner::boyer_moore_scanner(pattern_view _pattern, const tables& _tables)
+        : pattern_(_pattern)
+        , bc_skips_(std::shared_ptr<const void>(), _tables.bc_skips)
+        , gs_skips_(std::shared_ptr<const std::uint16_t>(), _tables.gs_skips)
+        , skip_pos_(_tables.skip_pos)
+        , wide_bc_skips_(_tables.wide)
+    {
+        rbc_skips_.set(std::shared_ptr<const void>(std::shared_ptr<const void>(), _tables.rbc_skips),
+            _tables.rbc_skips ? _tables.rskip_pos : SIZE_MAX);
+    }
 
-                std::size_t last_prefix = last;
+    inline boyer_moore_scanner::tables boyer_moore_scanner::get_tables() const
+    {
+        tables result;
 
-                for (std::size_t i = trimmed_size; i--;)
-                {
-                    if (is_prefix(i + 1))
-                        last_prefix = i + 1;
+        // Kept alive by the scanner, as rbc_skips_ never changes once built
+        result.bc_skips = bc_skips_.get();
+        result.rbc_skips = get_rbc_skips(result.rskip_pos);
+        result.gs_skips = gs_skips_.get();
+        result.skip_pos = skip_pos_;
+        result.wide = wide_bc_skips_;
 
-                    gs_skips_[i] = last_prefix + (last - i);
-                }
+        return result;
+    }
 
-                for (std::size_t i = 0; i < last; ++i)
-                {
-                    std::size_t suffix_length = get_suffix_length(i);
-                    std::size_t pos = last - suffix_length;
+    inline std::mutex& boyer_moore_scanner::lazy_reverse_skips::get_mutex()
+    {
+        static std::mutex mutex;
 
-                    if (bytes[i - suffix_length] != bytes[pos])
-                        gs_skips_[pos] = suffix_length + (last - i);
-                }
-            }
-            else
+        return mutex;
+    }
+
+    inline boyer_moore_scanner::lazy_reverse_skips::lazy_reverse_skips(const lazy_reverse_skips& other)
+    {
+        *this = other;
+    }
+
+    inline boyer_moore_scanner::lazy_reverse_skips& boyer_moore_scanner::lazy_reverse_skips::operator=(
+        const lazy_reverse_skips& other)
+    {
+        // A copy taken while other is still being built builds its own table later
+        if (other.ready_.load(std::memory_order_acquire))
+        {
+            skips_ = other.skips_;
+            skip_pos_ = other.skip_pos_;
+            ready_.store(true, std::memory_order_relaxed);
+        }
+        else
+        {
+            skips_ = nullptr;
+            skip_pos_ = SIZE_MAX;
+            ready_.store(false, std::memory_order_relaxed);
+        }
+
+        return *this;
+    }
+
+    template <typename Builder>
+    inline const void* boyer_moore_scanner::lazy_reverse_skips::get(std::size_t& skip_pos, Builder builder) const
+    {
+        if (MEM_UNLIKELY(!ready_.load(std::memory_order_acquire)))
+        {
+            std::lock_guard<std::mutex> lock(get_mutex());
+
+            if (!ready_.load(std::memory_order_relaxed))
             {
-                bc_skips_[bytes[skip_pos_]] = 0;
+                skips_ = builder(skip_pos_);
+                ready_.store(true, std::memory_order_release);
             }
         }
+
+        skip_pos = skip_pos_;
+
+        return skips_.get();
+    }
+
+    inline void boyer_moore_scanner::lazy_reverse_skips::set(std::shared_ptr<const void> skips, std::size_t skip_pos)
+    {
+        skips_ = std::move(skips);
+        skip_pos_ = skip_pos;
+        ready_.store(true, std::memory_order_relaxed);
+    }
+
+    inline const void* boyer_moore_scanner::get_rbc_skips(std::size_t& skip_pos) const
+    {
+        return rbc_skips_.get(skip_pos, [this](std::size_t& result_pos) -> std::shared_ptr<const void> {
+            result_pos = SIZE_MAX;
+
+            if ((min_bc_skip_ == 0) || (pattern_.trimmed_size() == 0))
+                return nullptr;
+
+            std::size_t skips[256];
+            std::size_t average_skip = 0;
+
+            const std::size_t probe_pos = get_probe_pos(average_skip, skips, true);
+
+            if (average_skip < min_bc_skip_)
+                return nullptr;
+
+            result_pos = probe_pos;
+
+            return make_skips(skips);
+        });
     }
 
-    inline std::size_t boyer_moore_scanner::get_longest_run(std::size_t& length) const
+    inline std::shared_ptr<const void> boyer_moore_scanner::make_skips(const std::size_t* skips) const
     {
-        std::size_t max_skip = 0;
-        std::size_t skip_pos = 0;
+        std::shared_ptr<skip_table> table = std::make_shared<skip_table>();
+
+        for (std::size_t i = 0; i < 256; ++i)
+        {
+            if (wide_bc_skips_)
+                table->wide[i] = static_cast<std::uint16_t>(std::min<std::size_t>(skips[i], UINT16_MAX));
+            else
+                table->narrow[i] = static_cast<std::uint8_t>(skips[i]);
+        }
+
+        return table;
+    }
+
+    inline std::size_t boyer_moore_scanner::get_probe_pos(
+        std::size_t& average_skip, std::size_t* skips, bool reverse) const
+    {
+        const byte* const pat_bytes = pattern_.bytes();
+        const byte* const pat_masks = pattern_.masks();
+
+        const std::size_t trimmed_size = pattern_.trimmed_size();
+
+        // A reverse scan shifts the window backwards, which is a forward scan over the mirrored pattern
+        std::vector<byte> mirrored;
+
+        if (reverse)
+        {
+            mirrored.resize(trimmed_size * 2);
+
+            std::reverse_copy(pat_bytes, pat_bytes + trimmed_size, mirrored.data());
+            std::reverse_copy(pat_masks, pat_masks + trimmed_size, mirrored.data() + trimmed_size);
+        }
+
+        const byte* const bytes = reverse ? mirrored.data() : pat_bytes;
+        const byte* const masks = reverse ? mirrored.data() + trimmed_size : pat_masks;
+
+        // Horspool shifts for a probe at position k: the distance back to the nearest earlier position which
+        // could match the probed byte, or k + 1 if none can. Wildcards and nibble masks match several bytes.
+        std::size_t shifts[256];
+        std::fill(shifts, shifts + 256, std::size_t(1));
 
-        std::size_t current_skip = 0;
+        std::size_t best_pos = 0;
+        std::size_t best_total = 0;
 
-        const byte* const masks = pattern_->masks();
+        std::copy(shifts, shifts + 256, skips);
 
-        for (std::size_t i = 0; i < pattern_->trimmed_size(); ++i)
+        for (std::size_t k = 0; k < trimmed_size; ++k)
         {
-            if (masks[i] != 0xFF)
+            if (k != 0)
             {
-                if (current_skip > max_skip)
-                {
-                    max_skip = current_skip;
-                    skip_pos = i - current_skip;
-                }
+                const byte value = bytes[k - 1];
+                const byte mask = masks[k - 1];
 
-                current_skip = 0;
+                for (std::size_t i = 0; i < 256; ++i)
+                    shifts[i] = ((static_cast<byte>(i) & mask) == value) ? 1 : (shifts[i] + 1);
             }
-            else
+
+            std::size_t total = 0;
+
+            // Bytes which could match at the probe itself must be verified, so they don't count towards the shift
+            for (std::size_t i = 0; i < 256; ++i)
+            {
+                if ((static_cast<byte>(i) & masks[k]) != bytes[k])
+                    total += shifts[i];
+            }
+
+            // Prefer the probe with the largest average shift, assuming evenly distributed bytes
+            if (total >= best_total)
             {
-                ++current_skip;
+                best_total = total;
+                best_pos = k;
+
+                std::copy(shifts, shifts + 256, skips);
             }
         }
 
-        if (current_skip > max_skip)
+        average_skip = best_total / 256;
+
+        for (std::size_t i = 0; i < 256; ++i)
         {
-            max_skip = current_skip;
-            skip_pos = pattern_->trimmed_size() - current_skip;
+            if ((static_cast<byte>(i) & masks[best_pos]) == bytes[best_pos])
+                skips[i] = 0;
         }
 
-        length = max_skip;
+        return reverse ? (trimmed_size - 1 - best_pos) : best_pos;
+    }
+
+    inline std::shared_ptr<const std::uint16_t> boyer_moore_scanner::get_gs_skips() const
+    {
+        // Scanners for identical patterns share one table
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::weak_ptr<const std::vector<std::uint16_t>>> pool;
+        static std::size_t next_sweep = 64;
+
+        const byte* const bytes = pattern_.bytes();
+        const std::size_t trimmed_size = pattern_.trimmed_size();
+
+        std::string key(reinterpret_cast<const char*>(bytes), trimmed_size);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<const std::vector<std::uint16_t>>& entry = pool[key];
+
+        std::shared_ptr<const std::vector<std::uint16_t>> result = entry.lock();
+
+        if (result)
+            return std::shared_ptr<const std::uint16_t>(result, result->data());
+
+        std::vector<std::size_t> gs_skips(trimmed_size);
+
+        const std::size_t last = trimmed_size - 1;
+
+        std::size_t last_prefix = last;
+
+        for (std::size_t i = trimmed_size; i--;)
+        {
+            if (is_prefix(i + 1))
+                last_prefix = i + 1;
+
+            gs_skips[i] = last_prefix + (last - i);
+        }
+
+        for (std::size_t i = 0; i < last; ++i)
+        {
+            std::size_t suffix_length = get_suffix_length(i);
+            std::size_t pos = last - suffix_length;
+
+            if (bytes[i - suffix_length] != bytes[pos])
+                gs_skips[pos] = suffix_length + (last - i);
+        }
 
-        return skip_pos;
+        std::shared_ptr<std::vector<std::uint16_t>> table = std::make_shared<std::vector<std::uint16_t>>(trimmed_size);
+
+        for (std::size_t i = 0; i < trimmed_size; ++i)
+            (*table)[i] = static_cast<std::uint16_t>(std::min<std::size_t>(gs_skips[i], UINT16_MAX));
+
+        entry = table;
+
+        // Drop entries whose scanners have all been destroyed, but only once the pool has doubled since the last
+        // sweep, so building many scanners stays linear
+        if (pool.size() >= next_sweep)
+        {
+            for (auto i = pool.begin(); i != pool.end();)
+            {
+                if (i->second.expired())
+                    i = pool.erase(i);
+                else
+                    ++i;
+            }
+
+            next_sweep = std::max<std::size_t>(64, pool.size() * 2);
+        }
+
+        return std::shared_ptr<const std::uint16_t>(table, table->data());
     }
 
     inline bool boyer_moore_scanner::is_prefix(std::size_t pos) const
     {
-        const std::size_t suffix_length = pattern_->trimmed_size() - pos;
+        const std::size_t suffix_length = pattern_.trimmed_size() - pos;
 
-        const byte* const bytes = pattern_->bytes();
+        const byte* const bytes = pattern_.bytes();
 
         for (std::size_t i = 0; i < suffix_length; ++i)
             if (bytes[i] != bytes[pos + i])
@@ -159,9 +457,9 @@ namespace mem
 
     inline std::size_t boyer_moore_scanner::get_suffix_length(std::size_t pos) const
     {
-        const std::size_t last = pattern_->trimmed_size() - 1;
+        const std::size_t last = pattern_.trimmed_size() - 1;
 
-        const byte* const bytes = pattern_->bytes();
+        const byte* const bytes = pattern_.bytes();
 
         std::size_t i = 0;
 
@@ -171,142 +469,285 @@ namespace mem
         return i;
     }
 
-    inline pointer boyer_moore_scanner::scan(region range) const
+    template <typename Func>
+    inline pointer boyer_moore_scanner::operator()(region range, Func func) const
     {
-        const std::size_t trimmed_size = pattern_->trimmed_size();
+        const std::size_t trimmed_size = pattern_.trimmed_size();
 
         if (!trimmed_size)
             return nullptr;
 
-        const std::size_t original_size = pattern_->size();
+        const std::size_t original_size = pattern_.size();
         const std::size_t region_size = range.size;
 
         if (original_size > region_size)
             return nullptr;
 
-        const byte* const region_base = range.start.as<const byte*>();
-        const byte* const region_end = region_base + region_size;
+        if (bc_skips_)
+        {
+            if (wide_bc_skips_)
+                return scan_skips(range, static_cast<const std::uint16_t*>(bc_skips_.get()), func);
 
-        const byte* current = region_base;
-        const byte* const end = region_end - original_size + 1;
+            return scan_skips(range, static_cast<const std::uint8_t*>(bc_skips_.get()), func);
+        }
 
-        const std::size_t last = trimmed_size - 1;
+        const byte* current = range.start.as<const byte*>();
+        const byte* const end = current + region_size - original_size + 1;
 
-        const byte* const pat_bytes = pattern_->bytes();
-        const std::size_t* const pat_skips = !bc_skips_.empty() ? bc_skips_.data() : nullptr;
+        const byte* const pat_bytes = pattern_.bytes();
 
-        if (pattern_->needs_masks())
+        if (pattern_.needs_masks())
         {
-            const byte* const pat_masks = pattern_->masks();
+            const byte* const pat_masks = pattern_.masks();
 
-            if (pat_skips)
+            while (MEM_LIKELY(current < end))
             {
-                const std::size_t pat_skip_pos = skip_pos_;
+                if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)) &&
+                    func(pointer(current)))
+                    return current;
 
-                while (MEM_LIKELY(current < end))
-                {
-                    std::size_t skip = pat_skips[current[pat_skip_pos]];
+                ++current;
+            }
+        }
+        else
+        {
+            while (MEM_LIKELY(current < end))
+            {
+                if (MEM_UNLIKELY(internal::match_bytes(current, pat_bytes, trimmed_size)) && func(pointer(current)))
+                    return current;
 
-                    current += skip;
+                ++current;
+            }
+        }
 
-                    if (MEM_LIKELY(skip != 0))
-                        continue;
+        return nullptr;
+    }
 
-                    for (std::size_t i = last; MEM_LIKELY((current[i] & pat_masks[i]) == pat_bytes[i]); --i)
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
-                    }
+    MEM_STRONG_INLINE pointer boyer_moore_scanner::scan(region range) const
+    {
+        return (*this)(range, [](pointer) { return true; });
+    }
 
-                    ++current;
-                }
+    inline pointer boyer_moore_scanner::rscan(region range) const
+    {
+        const std::size_t trimmed_size = pattern_.trimmed_size();
 
-                return nullptr;
+        if (!trimmed_size)
+            return nullptr;
+
+        const std::size_t original_size = pattern_.size();
+        const std::size_t region_size = range.size;
+
+        if (original_size > region_size)
+            return nullptr;
+
+        std::size_t rskip_pos = SIZE_MAX;
+        const void* const rbc_skips = get_rbc_skips(rskip_pos);
+
+        if (rbc_skips)
+        {
+            if (wide_bc_skips_)
+                return rscan_skips(range, static_cast<const std::uint16_t*>(rbc_skips), rskip_pos);
+
+            return rscan_skips(range, static_cast<const std::uint8_t*>(rbc_skips), rskip_pos);
+        }
+
+        const byte* const start = range.start.as<const byte*>();
+        const byte* current = start + region_size - original_size + 1;
+
+        const byte* const pat_bytes = pattern_.bytes();
+
+        if (pattern_.needs_masks())
+        {
+            const byte* const pat_masks = pattern_.masks();
+
+            while (MEM_LIKELY(current != start))
+            {
+                --current;
+
+                if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)))
+                    return current;
             }
-            else
+        }
+        else
+        {
+            while (MEM_LIKELY(current != start))
             {
-                while (MEM_LIKELY(current < end))
+                --current;
+
+                if (MEM_UNLIKELY(internal::match_bytes(current, pat_bytes, trimmed_size)))
+                    return current;
+            }
+        }
+
+        return nullptr;
+    }
+
+    MEM_STRONG_INLINE pattern_view boyer_moore_scanner::get_pattern() const noexcept
+    {
+        return pattern_;
+    }
+
+    template <typename T, typename Func>
+    inline pointer boyer_moore_scanner::scan_skips(region range, const T* pat_skips, Func& func) const
+    {
+        const std::size_t trimmed_size = pattern_.trimmed_size();
+        const std::size_t original_size = pattern_.size();
+
+        const byte* current = range.start.as<const byte*>();
+        const byte* const end = current + range.size - original_size + 1;
+
+        const std::size_t last = trimmed_size - 1;
+        const std::size_t pat_skip_pos = skip_pos_;
+
+        const byte* const pat_bytes = pattern_.bytes();
+
+        if (pattern_.needs_masks())
+        {
+            const byte* const pat_masks = pattern_.masks();
+
+            while (MEM_LIKELY(current < end))
+            {
+                std::size_t skip = pat_skips[current[pat_skip_pos]];
+
+                current += skip;
+
+                if (MEM_LIKELY(skip != 0))
+                    continue;
+
+                if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)) &&
+                    func(pointer(current)))
+                    return current;
+
+                ++current;
+            }
+        }
+        else if (gs_skips_)
+        {
+            const std::uint16_t* const pat_suffixes = gs_skips_.get();
+
+            current += last;
+            const byte* const end_plus_last = end + last;
+
+            while (MEM_LIKELY(current < end_plus_last))
+            {
+                std::size_t i = last;
+
+                while (MEM_LIKELY(*current == pat_bytes[i]))
                 {
-                    for (std::size_t i = last; MEM_LIKELY((current[i] & pat_masks[i]) == pat_bytes[i]); --i)
+                    if (MEM_UNLIKELY(i == 0))
                     {
-                        if (MEM_UNLIKELY(i == 0))
+                        if (func(pointer(current)))
                             return current;
+
+                        // Carry on from the last byte of the next candidate
+                        current += trimmed_size;
+                        i = last;
+
+                        if (MEM_UNLIKELY(current >= end_plus_last))
+                            return nullptr;
+
+                        continue;
                     }
 
-                    ++current;
+                    --current;
+                    --i;
                 }
 
-                return nullptr;
+                const std::size_t bc_skip = pat_skips[*current];
+                const std::size_t gs_skip = pat_suffixes[i];
+
+                current += (bc_skip > gs_skip) ? bc_skip : gs_skip;
             }
         }
         else
         {
-            if (pat_skips && !gs_skips_.empty())
+            while (MEM_LIKELY(current < end))
             {
-                const std::size_t* const pat_suffixes = gs_skips_.data();
+                std::size_t skip = pat_skips[current[pat_skip_pos]];
 
-                current += last;
-                const byte* const end_plus_last = end + last;
+                current += skip;
 
-                while (MEM_LIKELY(current < end_plus_last))
-                {
-                    std::size_t i = last;
+                if (MEM_LIKELY(skip != 0))
+                    continue;
 
-                    while (MEM_LIKELY(*current == pat_bytes[i]))
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
+                if (MEM_UNLIKELY(internal::match_bytes(current, pat_bytes, trimmed_size)) && func(pointer(current)))
+                    return current;
 
-                        --current;
-                        --i;
-                    }
+                ++current;
+            }
+        }
 
-                    const std::size_t bc_skip = pat_skips[*current];
-                    const std::size_t gs_skip = pat_suffixes[i];
+        return nullptr;
+    }
 
-                    current += (bc_skip > gs_skip) ? bc_skip : gs_skip;
-                }
+    template <typename T>
+    inline pointer boyer_moore_scanner::rscan_skips(region range, const T* pat_skips, std::size_t pat_skip_pos) const
+    {
+        const std::size_t trimmed_size = pattern_.trimmed_size();
+        const std::size_t original_size = pattern_.size();
 
-                return nullptr;
-            }
-            else if (pat_skips)
+        const byte* const start = range.start.as<const byte*>();
+
+        // Offset of the current candidate, which only moves towards the start of the range
+        std::size_t offset = range.size - original_size;
+
+        const byte* const pat_bytes = pattern_.bytes();
+
+        if (pattern_.needs_masks())
+        {
+            const byte* const pat_masks = pattern_.masks();
+
+            while (true)
             {
-                while (MEM_LIKELY(current < end))
+                const std::size_t skip = pat_skips[start[offset + pat_skip_pos]];
+
+                if (MEM_LIKELY(skip != 0))
                 {
-                    std::size_t skip = pat_skips[current[last]];
+                    if (MEM_UNLIKELY(offset < skip))
+                        break;
 
-                    current += skip;
+                    offset -= skip;
 
-                    if (MEM_LIKELY(skip != 0))
-                        continue;
+                    continue;
+                }
 
-                    for (std::size_t i = last; MEM_LIKELY(current[i] == pat_bytes[i]); --i)
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
-                    }
+                if (MEM_UNLIKELY(internal::match_masked(start + offset, pat_bytes, pat_masks, trimmed_size)))
+                    return start + offset;
 
-                    ++current;
-                }
+                if (MEM_UNLIKELY(offset == 0))
+                    break;
 
-                return nullptr;
+                --offset;
             }
-            else
+        }
+        else
+        {
+            while (true)
             {
-                while (MEM_LIKELY(current < end))
+                const std::size_t skip = pat_skips[start[offset + pat_skip_pos]];
+
+                if (MEM_LIKELY(skip != 0))
                 {
-                    for (std::size_t i = last; MEM_LIKELY(current[i] == pat_bytes[i]); --i)
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
-                    }
+                    if (MEM_UNLIKELY(offset < skip))
+                        break;
 
-                    ++current;
+                    offset -= skip;
+
+                    continue;
                 }
 
-                return nullptr;
+                if (MEM_UNLIKELY(internal::match_bytes(start + offset, pat_bytes, trimmed_size)))
+                    return start + offset;
+
+                if (MEM_UNLIKELY(offset == 0))
+                    break;
+
+                --offset;
             }
         }
+
+        return nullptr;
     }
 } // namespace mem
 
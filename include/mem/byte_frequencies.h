@@ -0,0 +1,156 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_BYTE_FREQUENCIES_BRICK_H
+#define MEM_BYTE_FREQUENCIES_BRICK_H
+
+#include "hasher.h"
+#include "mem.h"
+#include "module.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace mem
+{
+    // Ranks each byte value by how often it appears, from 0x00 (rarest) to 0xFF (most common).
+    // Uses the same layout as simd_scanner::default_frequencies(), so it can be passed to any scanner.
+    class frequency_table
+    {
+    private:
+        byte ranks_[256] {};
+
+    public:
+        frequency_table() = default;
+
+        explicit frequency_table(region range);
+        explicit frequency_table(const std::uint64_t* counts);
+
+        const byte* data() const noexcept;
+
+        byte operator[](byte value) const noexcept;
+    };
+
+    void count_bytes(region range, std::uint64_t* counts) noexcept;
+
+    // Counts the readable segments of a module once, and caches the table for the life of the process.
+    // Entries are keyed on the base, size and a hash of the first page (its headers), so a different module loaded at
+    // the same address gets its own table. Old tables are never freed, so returned pointers stay valid.
+    const byte* module_frequencies(module mod);
+
+    inline frequency_table::frequency_table(region range)
+    {
+        std::uint64_t counts[256] {};
+
+        count_bytes(range, counts);
+
+        *this = frequency_table(counts);
+    }
+
+    inline frequency_table::frequency_table(const std::uint64_t* counts)
+    {
+        byte order[256];
+
+        for (std::size_t i = 0; i < 256; ++i)
+            order[i] = static_cast<byte>(i);
+
+        std::stable_sort(order, order + 256, [counts](byte lhs, byte rhs) { return counts[lhs] < counts[rhs]; });
+
+        for (std::size_t i = 0; i < 256; ++i)
+            ranks_[order[i]] = static_cast<byte>(i);
+    }
+
+    MEM_STRONG_INLINE const byte* frequency_table::data() const noexcept
+    {
+        return ranks_;
+    }
+
+    MEM_STRONG_INLINE byte frequency_table::operator[](byte value) const noexcept
+    {
+        return ranks_[value];
+    }
+
+    inline void count_bytes(region range, std::uint64_t* counts) noexcept
+    {
+        // Spread consecutive bytes over separate tables, so repeated values don't serialize on the same counter
+        std::uint64_t tables[4][256] {};
+
+        const byte* current = range.start.as<const byte*>();
+        const byte* const end = current + range.size;
+
+        while (end - current >= 8)
+        {
+            std::uint64_t value;
+            std::memcpy(&value, current, sizeof(value));
+
+            ++tables[0][value & 0xFF];
+            ++tables[1][(value >> 8) & 0xFF];
+            ++tables[2][(value >> 16) & 0xFF];
+            ++tables[3][(value >> 24) & 0xFF];
+            ++tables[0][(value >> 32) & 0xFF];
+            ++tables[1][(value >> 40) & 0xFF];
+            ++tables[2][(value >> 48) & 0xFF];
+            ++tables[3][(value >> 56) & 0xFF];
+
+            current += 8;
+        }
+
+        while (current < end)
+            ++tables[0][*current++];
+
+        for (std::size_t i = 0; i < 256; ++i)
+            counts[i] += tables[0][i] + tables[1][i] + tables[2][i] + tables[3][i];
+    }
+
+    inline const byte* module_frequencies(module mod)
+    {
+        static std::mutex mutex;
+        static std::map<std::tuple<std::uintptr_t, std::size_t, std::uint64_t>, std::unique_ptr<frequency_table>> cache;
+
+        hasher64 headers;
+        headers.update(mod.start.as<const void*>(), (std::min<std::size_t>)(mod.size, 0x1000));
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::unique_ptr<frequency_table>& result =
+            cache[std::make_tuple(mod.start.as<std::uintptr_t>(), mod.size, headers.digest())];
+
+        if (!result)
+        {
+            std::uint64_t counts[256] {};
+
+            mod.enum_segments([&counts](region range, prot_flags prot) {
+                if (prot & prot_flags::R)
+                    count_bytes(range, counts);
+
+                return false;
+            });
+
+            result.reset(new frequency_table(counts));
+        }
+
+        return result->data();
+    }
+} // namespace mem
+
+#endif // MEM_BYTE_FREQUENCIES_BRICK_H
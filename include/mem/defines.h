@@ -26,7 +26,11 @@
 #    define MEM_ARCH_X86
 #endif
 
-#if defined(__AVX2__)
+#if defined(__AVX512BW__)
+#    define MEM_SIMD_AVX512BW
+#endif
+
+#if defined(__AVX2__) || defined(MEM_SIMD_AVX512BW)
 #    define MEM_SIMD_AVX2
 #endif
 
@@ -85,6 +89,12 @@
 #    define MEM_NOINLINE
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#    define MEM_TARGET(x) __attribute__((target(x)))
+#else
+#    define MEM_TARGET(x)
+#endif
+
 #include <climits>
 #include <cstddef>
 #include <cstdint>
@@ -216,12 +216,12 @@ namespace mem
 
 #elif defined(__unix__)
     inline signal_handler::signal_handler()
-        : sig_stack_(new char[MINSIGSTKSZ])
+        : sig_stack_(new char[static_cast<std::size_t>(MINSIGSTKSZ)])
     {
         stack_t new_stack {};
 
         new_stack.ss_sp = sig_stack_.get();
-        new_stack.ss_size = MINSIGSTKSZ;
+        new_stack.ss_size = static_cast<std::size_t>(MINSIGSTKSZ);
         new_stack.ss_flags = 0;
         sigaltstack(&new_stack, &old_stack_);
 
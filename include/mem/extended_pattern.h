@@ -0,0 +1,631 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_EXTENDED_PATTERN_BRICK_H
+#define MEM_EXTENDED_PATTERN_BRICK_H
+
+#include "pattern.h"
+#include "simd_scanner.h"
+
+#include <algorithm>
+
+namespace mem
+{
+    // Extends the pattern syntax with:
+    //   (74|75)    Alternation between sequences, which may be empty or of different lengths
+    //   [80-8F]    A byte within a range, with both bounds written as two hex digits
+    //   {2-6}      A gap of 2 to 6 bytes ({4} is a gap of exactly 4), with decimal lengths
+    // Matching is planned as a single scan for the longest fixed-length prefix, with alternatives and ranges merged
+    // into masked bytes, followed by a backtracking check of the full pattern at each candidate.
+    class extended_pattern
+    {
+    private:
+        enum class element_type : byte
+        {
+            value,
+            range,
+            gap,
+            alternation,
+        };
+
+        struct element
+        {
+            element_type type;
+
+            // value: (byte & mask) == value
+            byte value;
+            byte mask;
+
+            // range: the lowest and highest byte, gap: the shortest and longest length,
+            // alternation: the first and one past the last sequence
+            std::size_t min;
+            std::size_t max;
+        };
+
+        struct sequence
+        {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct continuation
+        {
+            const element* begin;
+            const element* end;
+            const continuation* next;
+        };
+
+        // Alternatives are stored before the sequences containing them, so the last sequence is the whole pattern
+        std::vector<element> elements_ {};
+        std::vector<sequence> sequences_ {};
+
+        pattern prefix_ {};
+
+        std::size_t min_size_ {0};
+        std::size_t max_size_ {0};
+
+        bool parse_sequence(char_queue& input, char wildcard, bool nested, sequence& result);
+        bool parse_bracket(char_queue& input, char close, element& result);
+
+        bool get_prefix(const sequence& seq, std::vector<byte>& bytes, std::vector<byte>& masks) const;
+        void get_sizes(const sequence& seq, std::size_t& min, std::size_t& max) const;
+
+        bool match_elements(const element* current, const element* end, const continuation* next, const byte* data,
+            std::size_t size) const noexcept;
+
+    public:
+        explicit extended_pattern() = default;
+
+        explicit extended_pattern(
+            const char* string, pattern::wildcard_t wildcard = static_cast<pattern::wildcard_t>('?'));
+
+        // size is the number of bytes readable from address
+        bool match(pointer address, std::size_t size) const noexcept;
+
+        const pattern& prefix() const noexcept;
+
+        std::size_t min_size() const noexcept;
+        std::size_t max_size() const noexcept;
+
+        explicit operator bool() const noexcept;
+    };
+
+    class extended_scanner : public scanner_base<extended_scanner>
+    {
+    private:
+        const extended_pattern* pattern_ {nullptr};
+        simd_scanner prefix_scanner_ {};
+
+    public:
+        extended_scanner() = default;
+
+        extended_scanner(const extended_pattern& pattern);
+        extended_scanner(const extended_pattern& pattern, const byte* frequencies);
+
+        pointer scan(region range) const;
+        pointer rscan(region range) const;
+    };
+
+    inline extended_pattern::extended_pattern(const char* string, pattern::wildcard_t wildcard)
+    {
+        char_queue input(string);
+
+        sequence root {};
+
+        if (!parse_sequence(input, static_cast<char>(wildcard), false, root) || (root.begin == root.end))
+        {
+            elements_.clear();
+            sequences_.clear();
+
+            return;
+        }
+
+        sequences_.push_back(root);
+
+        std::vector<byte> bytes;
+        std::vector<byte> masks;
+
+        get_prefix(root, bytes, masks);
+
+        prefix_ = pattern(bytes.data(), masks.data(), bytes.size());
+
+        get_sizes(root, min_size_, max_size_);
+    }
+
+    inline bool extended_pattern::parse_sequence(char_queue& input, char wildcard, bool nested, sequence& result)
+    {
+        std::vector<element> elements;
+
+        while (input)
+        {
+            const int current = input.peek();
+
+            if (current == ' ')
+            {
+                input.pop();
+
+                continue;
+            }
+
+            if ((current == '|') || (current == ')'))
+            {
+                if (!nested)
+                    return false;
+
+                break;
+            }
+
+            element entry {};
+
+            if (current == '(')
+            {
+                input.pop();
+
+                std::vector<sequence> alternatives;
+
+                while (true)
+                {
+                    sequence alternative {};
+
+                    if (!parse_sequence(input, wildcard, true, alternative))
+                        return false;
+
+                    alternatives.push_back(alternative);
+
+                    const int next = input.peek();
+
+                    input.pop();
+
+                    if (next == ')')
+                        break;
+
+                    if (next != '|')
+                        return false;
+                }
+
+                // Nested alternations were stored while parsing, so the alternatives are only added now to keep them
+                // contiguous
+                entry.type = element_type::alternation;
+                entry.min = sequences_.size();
+                sequences_.insert(sequences_.end(), alternatives.begin(), alternatives.end());
+                entry.max = sequences_.size();
+            }
+            else if ((current == '[') || (current == '{'))
+            {
+                input.pop();
+
+                if (!parse_bracket(input, (current == '[') ? ']' : '}', entry))
+                    return false;
+            }
+            else
+            {
+                std::size_t count = 1;
+
+                if (!internal::parse_chunk(input, wildcard, entry.value, entry.mask, count))
+                    return false;
+
+                entry.type = element_type::value;
+
+                elements.insert(elements.end(), count, entry);
+
+                continue;
+            }
+
+            elements.push_back(entry);
+        }
+
+        result.begin = elements_.size();
+        elements_.insert(elements_.end(), elements.begin(), elements.end());
+        result.end = elements_.size();
+
+        return true;
+    }
+
+    inline bool extended_pattern::parse_bracket(char_queue& input, char close, element& result)
+    {
+        // Ranges are always hex and gaps always decimal, so a bound can never be read as the other kind
+        const bool is_range = close == ']';
+
+        std::size_t values[2] {0, 0};
+        std::size_t digits[2] {0, 0};
+
+        std::size_t index = 0;
+
+        while (true)
+        {
+            const int current = input.peek();
+
+            input.pop();
+
+            if (current == close)
+                break;
+
+            if ((current == '-') && (index == 0))
+            {
+                index = 1;
+
+                continue;
+            }
+
+            const int temp = is_range ? xctoi(current) : dctoi(current);
+
+            if ((temp == -1) || (++digits[index] > 8))
+                return false;
+
+            values[index] = (values[index] * (is_range ? 16 : 10)) + static_cast<std::size_t>(temp);
+        }
+
+        if (is_range)
+        {
+            if (!index || (digits[0] != 2) || (digits[1] != 2))
+                return false;
+
+            result.type = element_type::range;
+        }
+        else
+        {
+            if (!digits[0] || (index && !digits[1]))
+                return false;
+
+            result.type = element_type::gap;
+        }
+
+        result.min = values[0];
+        result.max = index ? values[1] : values[0];
+
+        return result.min <= result.max;
+    }
+
+    inline bool extended_pattern::get_prefix(
+        const sequence& seq, std::vector<byte>& bytes, std::vector<byte>& masks) const
+    {
+        for (std::size_t i = seq.begin; i < seq.end; ++i)
+        {
+            const element& entry = elements_[i];
+
+            switch (entry.type)
+            {
+                case element_type::value:
+                {
+                    bytes.push_back(entry.value);
+                    masks.push_back(entry.mask);
+
+                    break;
+                }
+
+                case element_type::range:
+                {
+                    // Keep the high bits shared by every byte in the range
+                    byte mask = 0xFF;
+
+                    for (std::size_t diff = entry.min ^ entry.max; diff; diff >>= 1)
+                        mask = static_cast<byte>(mask << 1);
+
+                    bytes.push_back(static_cast<byte>(entry.min) & mask);
+                    masks.push_back(mask);
+
+                    break;
+                }
+
+                case element_type::gap:
+                {
+                    if (entry.min != entry.max)
+                        return false;
+
+                    bytes.insert(bytes.end(), entry.min, byte(0x00));
+                    masks.insert(masks.end(), entry.min, byte(0x00));
+
+                    break;
+                }
+
+                case element_type::alternation:
+                {
+                    std::vector<byte> merged_bytes;
+                    std::vector<byte> merged_masks;
+
+                    bool fixed = true;
+
+                    for (std::size_t j = entry.min; j < entry.max; ++j)
+                    {
+                        std::vector<byte> alt_bytes;
+                        std::vector<byte> alt_masks;
+
+                        fixed &= get_prefix(sequences_[j], alt_bytes, alt_masks);
+
+                        if (j == entry.min)
+                        {
+                            merged_bytes.swap(alt_bytes);
+                            merged_masks.swap(alt_masks);
+
+                            continue;
+                        }
+
+                        if (alt_bytes.size() != merged_bytes.size())
+                            fixed = false;
+
+                        const std::size_t size = std::min(alt_bytes.size(), merged_bytes.size());
+
+                        merged_bytes.resize(size);
+                        merged_masks.resize(size);
+
+                        // Only keep the bits which are the same in both
+                        for (std::size_t k = 0; k < size; ++k)
+                        {
+                            const byte mask = merged_masks[k] & alt_masks[k] &
+                                static_cast<byte>(~(merged_bytes[k] ^ alt_bytes[k]));
+
+                            merged_bytes[k] &= mask;
+                            merged_masks[k] = mask;
+                        }
+                    }
+
+                    bytes.insert(bytes.end(), merged_bytes.begin(), merged_bytes.end());
+                    masks.insert(masks.end(), merged_masks.begin(), merged_masks.end());
+
+                    if (!fixed)
+                        return false;
+
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    inline void extended_pattern::get_sizes(const sequence& seq, std::size_t& min, std::size_t& max) const
+    {
+        min = 0;
+        max = 0;
+
+        for (std::size_t i = seq.begin; i < seq.end; ++i)
+        {
+            const element& entry = elements_[i];
+
+            switch (entry.type)
+            {
+                case element_type::value:
+                case element_type::range:
+                {
+                    min += 1;
+                    max += 1;
+
+                    break;
+                }
+
+                case element_type::gap:
+                {
+                    min += entry.min;
+                    max += entry.max;
+
+                    break;
+                }
+
+                case element_type::alternation:
+                {
+                    std::size_t alt_min = SIZE_MAX;
+                    std::size_t alt_max = 0;
+
+                    for (std::size_t j = entry.min; j < entry.max; ++j)
+                    {
+                        std::size_t seq_min = 0;
+                        std::size_t seq_max = 0;
+
+                        get_sizes(sequences_[j], seq_min, seq_max);
+
+                        alt_min = std::min(alt_min, seq_min);
+                        alt_max = std::max(alt_max, seq_max);
+                    }
+
+                    min += alt_min;
+                    max += alt_max;
+
+                    break;
+                }
+            }
+        }
+    }
+
+    inline bool extended_pattern::match_elements(const element* current, const element* end,
+        const continuation* next, const byte* data, std::size_t size) const noexcept
+    {
+        for (; current != end; ++current)
+        {
+            switch (current->type)
+            {
+                case element_type::value:
+                {
+                    if (!size || ((*data & current->mask) != current->value))
+                        return false;
+
+                    ++data;
+                    --size;
+
+                    break;
+                }
+
+                case element_type::range:
+                {
+                    if (!size || (*data < current->min) || (*data > current->max))
+                        return false;
+
+                    ++data;
+                    --size;
+
+                    break;
+                }
+
+                case element_type::gap:
+                {
+                    for (std::size_t i = current->min; (i <= current->max) && (i <= size); ++i)
+                    {
+                        if (match_elements(current + 1, end, next, data + i, size - i))
+                            return true;
+                    }
+
+                    return false;
+                }
+
+                case element_type::alternation:
+                {
+                    const continuation rest {current + 1, end, next};
+
+                    for (std::size_t i = current->min; i < current->max; ++i)
+                    {
+                        const sequence& alternative = sequences_[i];
+
+                        if (match_elements(elements_.data() + alternative.begin, elements_.data() + alternative.end,
+                                &rest, data, size))
+                            return true;
+                    }
+
+                    return false;
+                }
+            }
+        }
+
+        if (next)
+            return match_elements(next->begin, next->end, next->next, data, size);
+
+        return true;
+    }
+
+    inline bool extended_pattern::match(pointer address, std::size_t size) const noexcept
+    {
+        if (sequences_.empty() || (size < min_size_))
+            return false;
+
+        const sequence& root = sequences_.back();
+
+        return match_elements(
+            elements_.data() + root.begin, elements_.data() + root.end, nullptr, address.as<const byte*>(), size);
+    }
+
+    MEM_STRONG_INLINE const pattern& extended_pattern::prefix() const noexcept
+    {
+        return prefix_;
+    }
+
+    MEM_STRONG_INLINE std::size_t extended_pattern::min_size() const noexcept
+    {
+        return min_size_;
+    }
+
+    MEM_STRONG_INLINE std::size_t extended_pattern::max_size() const noexcept
+    {
+        return max_size_;
+    }
+
+    MEM_STRONG_INLINE extended_pattern::operator bool() const noexcept
+    {
+        return !sequences_.empty();
+    }
+
+    inline extended_scanner::extended_scanner(const extended_pattern& _pattern)
+        : extended_scanner(_pattern, simd_scanner::default_frequencies())
+    {}
+
+    inline extended_scanner::extended_scanner(const extended_pattern& _pattern, const byte* frequencies)
+        : pattern_(&_pattern)
+        , prefix_scanner_(_pattern.prefix(), frequencies)
+    {}
+
+    inline pointer extended_scanner::scan(region range) const
+    {
+        const std::size_t min_size = pattern_->min_size();
+
+        if (!min_size || (min_size > range.size))
+            return nullptr;
+
+        const byte* const start = range.start.as<const byte*>();
+        const byte* const end = start + range.size;
+        const byte* const last = end - min_size;
+
+        if (pattern_->prefix().trimmed_size())
+        {
+            region remaining = range;
+
+            while (true)
+            {
+                const byte* const current = prefix_scanner_.scan(remaining).as<const byte*>();
+
+                if (!current || (current > last))
+                    return nullptr;
+
+                if (pattern_->match(current, static_cast<std::size_t>(end - current)))
+                    return current;
+
+                remaining = range.sub_region(current + 1);
+            }
+        }
+
+        for (const byte* current = start; current <= last; ++current)
+        {
+            if (pattern_->match(current, static_cast<std::size_t>(end - current)))
+                return current;
+        }
+
+        return nullptr;
+    }
+
+    inline pointer extended_scanner::rscan(region range) const
+    {
+        const std::size_t min_size = pattern_->min_size();
+
+        if (!min_size || (min_size > range.size))
+            return nullptr;
+
+        const byte* const start = range.start.as<const byte*>();
+        const byte* const end = start + range.size;
+        const byte* const last = end - min_size;
+
+        const std::size_t prefix_size = pattern_->prefix().size();
+
+        if (pattern_->prefix().trimmed_size())
+        {
+            region remaining = range;
+
+            while (true)
+            {
+                const byte* const current = prefix_scanner_.rscan(remaining).as<const byte*>();
+
+                if (!current)
+                    return nullptr;
+
+                if ((current <= last) && pattern_->match(current, static_cast<std::size_t>(end - current)))
+                    return current;
+
+                // Only keep candidates starting before this one
+                remaining.size = static_cast<std::size_t>(current - start) + prefix_size - 1;
+            }
+        }
+
+        for (const byte* current = last + 1; current != start;)
+        {
+            --current;
+
+            if (pattern_->match(current, static_cast<std::size_t>(end - current)))
+                return current;
+        }
+
+        return nullptr;
+    }
+} // namespace mem
+
+#endif // MEM_EXTENDED_PATTERN_BRICK_H
@@ -0,0 +1,333 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_FILE_MODULE_BRICK_H
+#define MEM_FILE_MODULE_BRICK_H
+
+#include "mem.h"
+#include "prot_flags.h"
+#include "slice.h"
+
+#include <cstring>
+
+#if defined(__unix__)
+#    include <fcntl.h>
+#    include <link.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace mem
+{
+#if defined(__unix__)
+    // An ELF file mapped read-only from disk, without loading or relocating it.
+    // The region covers the raw file, so segments are laid out by file offset rather than vaddr.
+    class file_module : public region
+    {
+    private:
+        bool is_valid() const noexcept;
+
+        // Checked without forming the end offset, which can overflow for corrupt headers
+        bool contains_range(std::uint64_t offset, std::uint64_t length) const noexcept;
+
+        void unmap() noexcept;
+
+    public:
+        file_module() = default;
+
+        explicit file_module(const char* path);
+        ~file_module();
+
+        file_module(file_module&& rhs) noexcept;
+        file_module(const file_module&) = delete;
+
+        file_module& operator=(file_module&& rhs) noexcept;
+        file_module& operator=(const file_module&) = delete;
+
+        explicit operator bool() const noexcept;
+
+        const ElfW(Ehdr) & elf_header() const;
+        slice<const ElfW(Phdr)> program_headers() const;
+        slice<const ElfW(Shdr)> section_headers() const;
+
+        const char* section_name(const ElfW(Shdr) & section) const;
+        region section_data(const ElfW(Shdr) & section) const;
+
+        pointer from_vaddr(std::uintptr_t vaddr) const;
+        std::uintptr_t to_vaddr(pointer address) const;
+
+        template <typename Func>
+        void enum_segments(Func func) const;
+
+        template <typename Func>
+        void enum_sections(Func func) const;
+    };
+
+    inline file_module::file_module(const char* path)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1)
+            return;
+
+        struct stat st;
+
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+        {
+            const std::size_t length = static_cast<std::size_t>(st.st_size);
+
+            void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+                start = data;
+                size = length;
+            }
+        }
+
+        close(fd);
+
+        if (size && !is_valid())
+            unmap();
+    }
+
+    inline file_module::~file_module()
+    {
+        unmap();
+    }
+
+    MEM_STRONG_INLINE file_module::file_module(file_module&& rhs) noexcept
+        : region(rhs)
+    {
+        rhs.start = nullptr;
+        rhs.size = 0;
+    }
+
+    inline file_module& file_module::operator=(file_module&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            unmap();
+
+            start = rhs.start;
+            size = rhs.size;
+
+            rhs.start = nullptr;
+            rhs.size = 0;
+        }
+
+        return *this;
+    }
+
+    MEM_STRONG_INLINE file_module::operator bool() const noexcept
+    {
+        return size != 0;
+    }
+
+    inline bool file_module::is_valid() const noexcept
+    {
+        if (size < sizeof(ElfW(Ehdr)))
+            return false;
+
+        const ElfW(Ehdr)& ehdr = elf_header();
+
+        // clang-format off
+        if (ehdr.e_ident[EI_MAG0] != ELFMAG0 ||
+            ehdr.e_ident[EI_MAG1] != ELFMAG1 ||
+            ehdr.e_ident[EI_MAG2] != ELFMAG2 ||
+            ehdr.e_ident[EI_MAG3] != ELFMAG3)
+            return false;
+
+        // The headers are read in place, so they must use the layout and byte order of the host
+        if (ehdr.e_ident[EI_CLASS] != ((sizeof(void*) == 8) ? ELFCLASS64 : ELFCLASS32))
+            return false;
+
+#    if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        if (ehdr.e_ident[EI_DATA] != ELFDATA2MSB)
+            return false;
+#    else
+        if (ehdr.e_ident[EI_DATA] != ELFDATA2LSB)
+            return false;
+#    endif
+
+        if (ehdr.e_phentsize != sizeof(ElfW(Phdr)) ||
+            (ehdr.e_shnum && ehdr.e_shentsize != sizeof(ElfW(Shdr))))
+            return false;
+        // clang-format on
+
+        if (!contains_range(ehdr.e_phoff, std::size_t(ehdr.e_phnum) * sizeof(ElfW(Phdr))))
+            return false;
+
+        if (!contains_range(ehdr.e_shoff, std::size_t(ehdr.e_shnum) * sizeof(ElfW(Shdr))))
+            return false;
+
+        return true;
+    }
+
+    MEM_STRONG_INLINE bool file_module::contains_range(std::uint64_t offset, std::uint64_t length) const noexcept
+    {
+        return (offset <= size) && (length <= (size - offset));
+    }
+
+    inline void file_module::unmap() noexcept
+    {
+        if (size)
+            munmap(start.as<void*>(), size);
+
+        start = nullptr;
+        size = 0;
+    }
+
+    MEM_STRONG_INLINE const ElfW(Ehdr) & file_module::elf_header() const
+    {
+        return start.at<const ElfW(Ehdr)>(0);
+    }
+
+    MEM_STRONG_INLINE slice<const ElfW(Phdr)> file_module::program_headers() const
+    {
+        const ElfW(Ehdr)& ehdr = elf_header();
+        const ElfW(Phdr)* phdr = start.at<const ElfW(Phdr)[]>(ehdr.e_phoff);
+
+        return {phdr, ehdr.e_phnum};
+    }
+
+    MEM_STRONG_INLINE slice<const ElfW(Shdr)> file_module::section_headers() const
+    {
+        const ElfW(Ehdr)& ehdr = elf_header();
+        const ElfW(Shdr)* shdr = start.at<const ElfW(Shdr)[]>(ehdr.e_shoff);
+
+        return {shdr, ehdr.e_shnum};
+    }
+
+    inline const char* file_module::section_name(const ElfW(Shdr) & section) const
+    {
+        const ElfW(Ehdr)& ehdr = elf_header();
+
+        if (ehdr.e_shstrndx >= ehdr.e_shnum)
+            return nullptr;
+
+        const region strings = section_data(section_headers()[ehdr.e_shstrndx]);
+
+        if (section.sh_name >= strings.size)
+            return nullptr;
+
+        const char* name = strings.start.add(section.sh_name).as<const char*>();
+
+        if (!std::memchr(name, '\0', strings.size - section.sh_name))
+            return nullptr;
+
+        return name;
+    }
+
+    inline region file_module::section_data(const ElfW(Shdr) & section) const
+    {
+        if (section.sh_type == SHT_NOBITS)
+            return region();
+
+        if (!contains_range(section.sh_offset, section.sh_size))
+            return region();
+
+        return region(start.add(section.sh_offset), section.sh_size);
+    }
+
+    inline pointer file_module::from_vaddr(std::uintptr_t vaddr) const
+    {
+        for (const ElfW(Phdr) & segment : program_headers())
+        {
+            if ((segment.p_type != PT_LOAD) || !contains_range(segment.p_offset, segment.p_filesz))
+                continue;
+
+            if ((vaddr >= segment.p_vaddr) && ((vaddr - segment.p_vaddr) < segment.p_filesz))
+                return start.add(segment.p_offset + (vaddr - segment.p_vaddr));
+        }
+
+        return nullptr;
+    }
+
+    inline std::uintptr_t file_module::to_vaddr(pointer address) const
+    {
+        if (!contains(address))
+            return 0;
+
+        const std::size_t offset = static_cast<std::size_t>(address - start);
+
+        for (const ElfW(Phdr) & segment : program_headers())
+        {
+            if (segment.p_type != PT_LOAD)
+                continue;
+
+            if ((offset >= segment.p_offset) && ((offset - segment.p_offset) < segment.p_filesz))
+                return segment.p_vaddr + (offset - segment.p_offset);
+        }
+
+        return 0;
+    }
+
+    template <typename Func>
+    inline void file_module::enum_segments(Func func) const
+    {
+        for (const ElfW(Phdr) & segment : program_headers())
+        {
+            if (segment.p_type != PT_LOAD)
+                continue;
+
+            if (!segment.p_filesz)
+                continue;
+
+            if (!contains_range(segment.p_offset, segment.p_filesz))
+                continue;
+
+            // Only the file backed part of the segment, the rest is zero filled when loaded
+            const mem::region range(start.add(segment.p_offset), segment.p_filesz);
+
+            prot_flags prot = prot_flags::NONE;
+
+            if (segment.p_flags & PF_R)
+                prot |= prot_flags::R;
+
+            if (segment.p_flags & PF_W)
+                prot |= prot_flags::W;
+
+            if (segment.p_flags & PF_X)
+                prot |= prot_flags::X;
+
+            if (func(range, prot))
+                return;
+        }
+    }
+
+    template <typename Func>
+    inline void file_module::enum_sections(Func func) const
+    {
+        for (const ElfW(Shdr) & section : section_headers())
+        {
+            const region range = section_data(section);
+
+            if (!range.size)
+                continue;
+
+            if (func(section_name(section), range))
+                return;
+        }
+    }
+#endif
+} // namespace mem
+
+#endif // MEM_FILE_MODULE_BRICK_H
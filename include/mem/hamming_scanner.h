@@ -0,0 +1,370 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_HAMMING_SCANNER_BRICK_H
+#define MEM_HAMMING_SCANNER_BRICK_H
+
+#include "simd_scanner.h"
+
+#include <algorithm>
+
+namespace mem
+{
+    struct hamming_result
+    {
+        pointer address;
+        std::size_t mismatches;
+    };
+
+    struct hamming_column
+    {
+        std::uint32_t offset;
+        byte value;
+        byte mask;
+    };
+
+    // Matches a pattern with at most a fixed number of mismatching bytes. A byte mismatches if any of its masked bits
+    // differ, so wildcards never count towards the limit.
+    class hamming_scanner
+    {
+    private:
+        pattern_view pattern_ {};
+        std::size_t max_mismatches_ {0};
+
+        // Masked bytes of the pattern, rarest first so candidates exceed the limit as early as possible
+        std::vector<hamming_column> columns_ {};
+
+    public:
+        // Mismatches are counted in bytes, so larger limits are clamped
+        static constexpr const std::size_t mismatch_limit = 254;
+
+        hamming_scanner() = default;
+
+        hamming_scanner(pattern_view pattern, std::size_t max_mismatches);
+        hamming_scanner(pattern_view pattern, std::size_t max_mismatches, const byte* frequencies);
+
+        template <typename Func>
+        void operator()(region range, Func func) const;
+
+        std::vector<hamming_result> scan_all(region range) const;
+
+        pattern_view get_pattern() const noexcept;
+        std::size_t max_mismatches() const noexcept;
+    };
+
+    namespace internal
+    {
+        // Finds the next block of positions where at most limit columns mismatch. Each set bit of hits marks a match
+        // at that offset from the returned block, and the same index of counts holds its number of mismatches.
+        using count_mismatches_func = const byte* (*) (const byte* ptr, std::size_t num, const hamming_column* columns,
+            std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts);
+
+        std::size_t count_mismatches(const byte* current, const hamming_column* columns, std::size_t column_count,
+            std::size_t limit) noexcept;
+
+        const byte* count_mismatches_generic(const byte* ptr, std::size_t num, const hamming_column* columns,
+            std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts);
+
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+        const byte* count_mismatches_sse2(const byte* ptr, std::size_t num, const hamming_column* columns,
+            std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts);
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+        const byte* count_mismatches_avx2(const byte* ptr, std::size_t num, const hamming_column* columns,
+            std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts);
+#    endif
+#endif
+
+        count_mismatches_func select_count_mismatches() noexcept;
+        count_mismatches_func get_count_mismatches() noexcept;
+    } // namespace internal
+
+    constexpr const std::size_t hamming_scanner::mismatch_limit;
+
+    inline hamming_scanner::hamming_scanner(pattern_view _pattern, std::size_t max_mismatches)
+        : hamming_scanner(_pattern, max_mismatches, simd_scanner::default_frequencies())
+    {}
+
+    inline hamming_scanner::hamming_scanner(
+        pattern_view _pattern, std::size_t max_mismatches, const byte* frequencies)
+        : pattern_(_pattern)
+        , max_mismatches_(std::min(max_mismatches, mismatch_limit))
+    {
+        const byte* const bytes = _pattern.bytes();
+        const byte* const masks = _pattern.masks();
+
+        for (std::size_t i = 0; i < _pattern.trimmed_size(); ++i)
+        {
+            if (masks[i])
+                columns_.push_back({static_cast<std::uint32_t>(i), static_cast<byte>(bytes[i] & masks[i]), masks[i]});
+        }
+
+        // Partially masked bytes are more likely to match, so they go last
+        std::stable_sort(columns_.begin(), columns_.end(), [frequencies](const hamming_column& lhs,
+                                                               const hamming_column& rhs) {
+            const std::size_t lhs_freq = (lhs.mask == 0xFF) ? frequencies[lhs.value] : 0x100;
+            const std::size_t rhs_freq = (rhs.mask == 0xFF) ? frequencies[rhs.value] : 0x100;
+
+            return lhs_freq < rhs_freq;
+        });
+    }
+
+    template <typename Func>
+    inline void hamming_scanner::operator()(region range, Func func) const
+    {
+        const std::size_t original_size = pattern_.size();
+
+        if (!pattern_.trimmed_size() || (original_size > range.size))
+            return;
+
+        const internal::count_mismatches_func kernel = internal::get_count_mismatches();
+
+        const byte* current = range.start.as<const byte*>();
+        std::size_t count = range.size - original_size + 1;
+
+        byte counts[64];
+
+        while (MEM_LIKELY(count != 0))
+        {
+            std::uint64_t hits = 0;
+
+            const byte* const block = kernel(current, count, columns_.data(), columns_.size(),
+                static_cast<byte>(max_mismatches_), hits, counts);
+
+            if (!hits)
+                break;
+
+            std::size_t i = 0;
+
+            for (; hits; ++i, hits >>= 1)
+            {
+                if ((hits & 1) && func(hamming_result {pointer(block + i), counts[i]}))
+                    return;
+            }
+
+            count -= static_cast<std::size_t>(block + i - current);
+            current = block + i;
+        }
+    }
+
+    inline std::vector<hamming_result> hamming_scanner::scan_all(region range) const
+    {
+        std::vector<hamming_result> results;
+
+        (*this)(range, [&results](const hamming_result& result) {
+            results.push_back(result);
+
+            return false;
+        });
+
+        return results;
+    }
+
+    MEM_STRONG_INLINE pattern_view hamming_scanner::get_pattern() const noexcept
+    {
+        return pattern_;
+    }
+
+    MEM_STRONG_INLINE std::size_t hamming_scanner::max_mismatches() const noexcept
+    {
+        return max_mismatches_;
+    }
+
+    MEM_STRONG_INLINE std::size_t internal::count_mismatches(
+        const byte* current, const hamming_column* columns, std::size_t column_count, std::size_t limit) noexcept
+    {
+        std::size_t total = 0;
+
+        for (std::size_t i = 0; (i < column_count) && (total <= limit); ++i)
+            total += (current[columns[i].offset] & columns[i].mask) != columns[i].value;
+
+        return total;
+    }
+
+    inline const byte* internal::count_mismatches_generic(const byte* ptr, std::size_t num,
+        const hamming_column* columns, std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts)
+    {
+        for (; num != 0; --num, ++ptr)
+        {
+            const std::size_t total = count_mismatches(ptr, columns, column_count, limit);
+
+            if (MEM_UNLIKELY(total <= limit))
+            {
+                counts[0] = static_cast<byte>(total);
+                hits = 1;
+
+                return ptr;
+            }
+        }
+
+        hits = 0;
+
+        return ptr;
+    }
+
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+    // Each lane counts the mismatches for one position, saturating at 255
+#    define l_COUNT_MISMATCHES_BODY()                                                                                 \
+        if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                                     \
+        {                                                                                                            \
+            const l_SIMD_TYPE simd_one = l_SIMD_FILL(1);                                                             \
+            const l_SIMD_TYPE simd_limit = l_SIMD_FILL(limit);                                                       \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                              \
+            {                                                                                                        \
+                l_SIMD_TYPE total = l_SIMD_ZERO();                                                                   \
+                std::size_t i = 0;                                                                                   \
+                                                                                                                     \
+                for (; i < column_count; ++i)                                                                        \
+                {                                                                                                    \
+                    const hamming_column& column = columns[i];                                                       \
+                                                                                                                     \
+                    const l_SIMD_TYPE value = l_SIMD_AND(l_SIMD_LOAD(ptr + column.offset), l_SIMD_FILL(column.mask)); \
+                    const l_SIMD_TYPE equal = l_SIMD_CMPEQ(value, l_SIMD_FILL(column.value));                        \
+                                                                                                                     \
+                    total = l_SIMD_ADDS(total, l_SIMD_ANDNOT(equal, simd_one));                                      \
+                                                                                                                     \
+                    if ((i >= limit) && (l_SIMD_WITHIN_MASK(total, simd_limit) == 0))                                \
+                        break;                                                                                       \
+                }                                                                                                    \
+                                                                                                                     \
+                num -= l_SIMD_SIZEOF(1);                                                                             \
+                ptr += l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                if (i == column_count)                                                                               \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_WITHIN_MASK(total, simd_limit);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                    {                                                                                                \
+                        l_SIMD_STORE(counts, total);                                                                 \
+                        hits = mask;                                                                                 \
+                                                                                                                     \
+                        return ptr - l_SIMD_SIZEOF(1);                                                               \
+                    }                                                                                                \
+                }                                                                                                    \
+            }                                                                                                        \
+        }                                                                                                            \
+                                                                                                                     \
+        return count_mismatches_generic(ptr, num, columns, column_count, limit, hits, counts);
+
+#    define l_SIMD_SIZEOF(N) (sizeof(l_SIMD_TYPE) * N)
+
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+#        define l_SIMD_TYPE __m128i
+#        define l_SIMD_ZERO() _mm_setzero_si128()
+#        define l_SIMD_FILL(x) _mm_set1_epi8(static_cast<char>(x))
+#        define l_SIMD_LOAD(x) _mm_loadu_si128(reinterpret_cast<const __m128i*>(x))
+#        define l_SIMD_STORE(x, y) _mm_storeu_si128(reinterpret_cast<__m128i*>(x), y)
+#        define l_SIMD_AND(x, y) _mm_and_si128(x, y)
+#        define l_SIMD_ANDNOT(x, y) _mm_andnot_si128(x, y)
+#        define l_SIMD_ADDS(x, y) _mm_adds_epu8(x, y)
+#        define l_SIMD_CMPEQ(x, y) _mm_cmpeq_epi8(x, y)
+#        define l_SIMD_WITHIN_MASK(x, y) \
+            static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, y), x)))
+
+    MEM_TARGET("sse2")
+    inline const byte* internal::count_mismatches_sse2(const byte* ptr, std::size_t num, const hamming_column* columns,
+        std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts)
+    {
+        l_COUNT_MISMATCHES_BODY()
+    }
+
+#        undef l_SIMD_TYPE
+#        undef l_SIMD_ZERO
+#        undef l_SIMD_FILL
+#        undef l_SIMD_LOAD
+#        undef l_SIMD_STORE
+#        undef l_SIMD_AND
+#        undef l_SIMD_ANDNOT
+#        undef l_SIMD_ADDS
+#        undef l_SIMD_CMPEQ
+#        undef l_SIMD_WITHIN_MASK
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+#        define l_SIMD_TYPE __m256i
+#        define l_SIMD_ZERO() _mm256_setzero_si256()
+#        define l_SIMD_FILL(x) _mm256_set1_epi8(static_cast<char>(x))
+#        define l_SIMD_LOAD(x) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x))
+#        define l_SIMD_STORE(x, y) _mm256_storeu_si256(reinterpret_cast<__m256i*>(x), y)
+#        define l_SIMD_AND(x, y) _mm256_and_si256(x, y)
+#        define l_SIMD_ANDNOT(x, y) _mm256_andnot_si256(x, y)
+#        define l_SIMD_ADDS(x, y) _mm256_adds_epu8(x, y)
+#        define l_SIMD_CMPEQ(x, y) _mm256_cmpeq_epi8(x, y)
+#        define l_SIMD_WITHIN_MASK(x, y) \
+            static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(x, y), x)))
+
+    MEM_TARGET("avx2")
+    inline const byte* internal::count_mismatches_avx2(const byte* ptr, std::size_t num, const hamming_column* columns,
+        std::size_t column_count, byte limit, std::uint64_t& hits, byte* counts)
+    {
+        l_COUNT_MISMATCHES_BODY()
+    }
+
+#        undef l_SIMD_TYPE
+#        undef l_SIMD_ZERO
+#        undef l_SIMD_FILL
+#        undef l_SIMD_LOAD
+#        undef l_SIMD_STORE
+#        undef l_SIMD_AND
+#        undef l_SIMD_ANDNOT
+#        undef l_SIMD_ADDS
+#        undef l_SIMD_CMPEQ
+#        undef l_SIMD_WITHIN_MASK
+#    endif
+
+#    undef l_SIMD_SIZEOF
+#    undef l_COUNT_MISMATCHES_BODY
+#endif
+
+    inline internal::count_mismatches_func internal::select_count_mismatches() noexcept
+    {
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+#    if defined(MEM_SIMD_SCANNER_NO_DISPATCH)
+#        if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+        return &count_mismatches_avx2;
+#        elif defined(MEM_SIMD_SCANNER_HAS_SSE2)
+        return &count_mismatches_sse2;
+#        endif
+#    else
+        switch (get_simd_level())
+        {
+            case simd_level::avx512bw:
+            case simd_level::avx2: return &count_mismatches_avx2;
+            case simd_level::sse2: return &count_mismatches_sse2;
+            case simd_level::none: break;
+        }
+#    endif
+#endif
+
+        return &count_mismatches_generic;
+    }
+
+    MEM_STRONG_INLINE internal::count_mismatches_func internal::get_count_mismatches() noexcept
+    {
+        static const count_mismatches_func kernel = select_count_mismatches();
+
+        return kernel;
+    }
+} // namespace mem
+
+#endif // MEM_HAMMING_SCANNER_BRICK_H
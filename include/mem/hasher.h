@@ -22,6 +22,9 @@
 
 #include "defines.h"
 
+#include <cstring>
+#include <type_traits>
+
 namespace mem
 {
     class hasher
@@ -40,6 +43,39 @@ namespace mem
         std::uint32_t digest() const noexcept;
     };
 
+    // Processes 8 bytes per round, using the rounds and finalizer from xxHash64
+    class hasher64
+    {
+    private:
+        std::uint64_t hash_;
+        std::uint64_t length_ {0};
+
+        // Bytes which do not yet fill a whole word
+        byte tail_[8] {};
+        std::size_t tail_size_ {0};
+
+        static std::uint64_t rotl(std::uint64_t value, unsigned shift) noexcept;
+        static std::uint64_t load(const byte* data) noexcept;
+
+        void round(std::uint64_t word) noexcept;
+
+    public:
+        static constexpr const std::uint64_t prime1 = 0x9E3779B185EBCA87;
+        static constexpr const std::uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+        static constexpr const std::uint64_t prime3 = 0x165667B19E3779F9;
+        static constexpr const std::uint64_t prime4 = 0x85EBCA77C2B2AE63;
+        static constexpr const std::uint64_t prime5 = 0x27D4EB2F165667C5;
+
+        hasher64(std::uint64_t seed = 0) noexcept;
+
+        void update(const void* data, std::size_t length) noexcept;
+
+        template <typename T>
+        void update(const T& value) noexcept;
+
+        std::uint64_t digest() const noexcept;
+    };
+
     MEM_STRONG_INLINE hasher::hasher(std::uint32_t seed) noexcept
         : hash_(seed)
     {}
@@ -76,6 +112,91 @@ namespace mem
 
         return hash;
     }
+
+    constexpr const std::uint64_t hasher64::prime1;
+    constexpr const std::uint64_t hasher64::prime2;
+    constexpr const std::uint64_t hasher64::prime3;
+    constexpr const std::uint64_t hasher64::prime4;
+    constexpr const std::uint64_t hasher64::prime5;
+
+    MEM_STRONG_INLINE hasher64::hasher64(std::uint64_t seed) noexcept
+        : hash_(seed + prime5)
+    {}
+
+    MEM_STRONG_INLINE std::uint64_t hasher64::rotl(std::uint64_t value, unsigned shift) noexcept
+    {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    MEM_STRONG_INLINE std::uint64_t hasher64::load(const byte* data) noexcept
+    {
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    MEM_STRONG_INLINE void hasher64::round(std::uint64_t word) noexcept
+    {
+        hash_ ^= rotl(word * prime2, 31) * prime1;
+        hash_ = (rotl(hash_, 27) * prime1) + prime4;
+    }
+
+    inline void hasher64::update(const void* data, std::size_t length) noexcept
+    {
+        const byte* current = static_cast<const byte*>(data);
+
+        length_ += length;
+
+        if (tail_size_)
+        {
+            const std::size_t count = (length < (8 - tail_size_)) ? length : (8 - tail_size_);
+
+            std::memcpy(tail_ + tail_size_, current, count);
+
+            tail_size_ += count;
+            current += count;
+            length -= count;
+
+            if (tail_size_ != 8)
+                return;
+
+            round(load(tail_));
+            tail_size_ = 0;
+        }
+
+        for (; length >= 8; current += 8, length -= 8)
+            round(load(current));
+
+        if (length)
+        {
+            std::memcpy(tail_, current, length);
+            tail_size_ = length;
+        }
+    }
+
+    template <typename T>
+    MEM_STRONG_INLINE void hasher64::update(const T& value) noexcept
+    {
+        static_assert(std::is_integral<T>::value, "Invalid Type");
+
+        update(&value, sizeof(value));
+    }
+
+    inline std::uint64_t hasher64::digest() const noexcept
+    {
+        std::uint64_t hash = hash_ + length_;
+
+        for (std::size_t i = 0; i < tail_size_; ++i)
+            hash = rotl(hash ^ (static_cast<std::uint64_t>(tail_[i]) * prime5), 11) * prime1;
+
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
 } // namespace mem
 
 #endif // MEM_HASHER_BRICK_H
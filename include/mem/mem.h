@@ -229,8 +229,11 @@ namespace mem
 #if defined(MEM_ARCH_X86_64)
     MEM_STRONG_INLINE pointer pointer::rip(std::size_t offset) const noexcept
     {
-        return static_cast<std::uintptr_t>(
-            static_cast<std::intptr_t>(value_ + offset) + *reinterpret_cast<const std::int32_t*>(value_));
+        // Displacements are rarely aligned, so read them with memcpy
+        std::int32_t displacement = 0;
+        std::memcpy(&displacement, reinterpret_cast<const void*>(value_), sizeof(displacement));
+
+        return static_cast<std::uintptr_t>(static_cast<std::intptr_t>(value_ + offset) + displacement);
     }
 #endif // MEM_ARCH_X86_64
 
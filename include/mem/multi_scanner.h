@@ -0,0 +1,266 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_MULTI_SCANNER_BRICK_H
+#define MEM_MULTI_SCANNER_BRICK_H
+
+#include "pattern.h"
+
+#include <algorithm>
+
+namespace mem
+{
+    struct multi_result
+    {
+        std::size_t index;
+        pointer address;
+    };
+
+    class multi_scanner
+    {
+    private:
+        struct anchor
+        {
+            std::uint32_t key;
+            std::uint32_t index;
+            std::size_t offset;
+        };
+
+        std::vector<const pattern*> patterns_ {};
+
+        // Patterns anchored on two adjacent fully masked bytes, sorted by key
+        std::vector<anchor> pairs_ {};
+
+        // Patterns anchored on a single fully masked byte, bucketed by key
+        std::vector<anchor> singles_ {};
+        std::vector<std::uint32_t> single_starts_ {};
+
+        // Patterns without any fully masked bytes, checked at every position
+        std::vector<std::uint32_t> unanchored_ {};
+
+        // One bit for every pair of bytes which could be part of a match
+        std::vector<std::uint64_t> filter_ {};
+
+        void add_pattern(std::uint32_t index, const byte* frequencies);
+
+        template <typename Func>
+        bool check(const anchor& entry, const byte* base, std::size_t size, std::size_t pos, Func& func) const;
+
+    public:
+        multi_scanner() = default;
+
+        multi_scanner(const std::vector<pattern>& patterns);
+        multi_scanner(const std::vector<pattern>& patterns, const byte* frequencies);
+
+        template <typename Func>
+        void operator()(region range, Func func) const;
+
+        std::vector<multi_result> scan_all(region range) const;
+    };
+
+    inline multi_scanner::multi_scanner(const std::vector<pattern>& patterns)
+        : multi_scanner(patterns, simd_scanner::default_frequencies())
+    {}
+
+    inline multi_scanner::multi_scanner(const std::vector<pattern>& patterns, const byte* frequencies)
+        : filter_(0x10000 / 64)
+    {
+        patterns_.reserve(patterns.size());
+
+        for (const pattern& pattern : patterns)
+            patterns_.push_back(&pattern);
+
+        for (std::uint32_t i = 0; i < patterns_.size(); ++i)
+            add_pattern(i, frequencies);
+
+        std::stable_sort(pairs_.begin(), pairs_.end(), [](const anchor& lhs, const anchor& rhs) {
+            return lhs.key < rhs.key;
+        });
+
+        std::stable_sort(singles_.begin(), singles_.end(), [](const anchor& lhs, const anchor& rhs) {
+            return lhs.key < rhs.key;
+        });
+
+        single_starts_.resize(257);
+
+        for (std::size_t i = 0, j = 0; i < 257; ++i)
+        {
+            while ((j < singles_.size()) && (singles_[j].key < i))
+                ++j;
+
+            single_starts_[i] = static_cast<std::uint32_t>(j);
+        }
+    }
+
+    inline void multi_scanner::add_pattern(std::uint32_t index, const byte* frequencies)
+    {
+        const pattern& pattern = *patterns_[index];
+
+        const std::size_t trimmed_size = pattern.trimmed_size();
+
+        if (!trimmed_size)
+            return;
+
+        const byte* const bytes = pattern.bytes();
+        const byte* const masks = pattern.masks();
+
+        std::size_t pair_pos = SIZE_MAX;
+        std::size_t pair_freq = SIZE_MAX;
+
+        for (std::size_t i = 1; i < trimmed_size; ++i)
+        {
+            if ((masks[i - 1] == 0xFF) && (masks[i] == 0xFF))
+            {
+                const std::size_t f = static_cast<std::size_t>(frequencies[bytes[i - 1]]) + frequencies[bytes[i]];
+
+                if (f <= pair_freq)
+                {
+                    pair_pos = i - 1;
+                    pair_freq = f;
+                }
+            }
+        }
+
+        if (pair_pos != SIZE_MAX)
+        {
+            const std::uint32_t key = bytes[pair_pos] | (static_cast<std::uint32_t>(bytes[pair_pos + 1]) << 8);
+
+            pairs_.push_back({key, index, pair_pos});
+
+            filter_[key >> 6] |= std::uint64_t(1) << (key & 63);
+
+            return;
+        }
+
+        const std::size_t skip_pos = pattern.get_skip_pos(frequencies);
+
+        if (skip_pos != SIZE_MAX)
+        {
+            const std::uint32_t key = bytes[skip_pos];
+
+            singles_.push_back({key, index, skip_pos});
+
+            for (std::uint32_t i = 0; i < 256; ++i)
+            {
+                const std::uint32_t pair_key = key | (i << 8);
+
+                filter_[pair_key >> 6] |= std::uint64_t(1) << (pair_key & 63);
+            }
+
+            return;
+        }
+
+        unanchored_.push_back(index);
+    }
+
+    template <typename Func>
+    MEM_STRONG_INLINE bool multi_scanner::check(
+        const anchor& entry, const byte* base, std::size_t size, std::size_t pos, Func& func) const
+    {
+        if (pos < entry.offset)
+            return false;
+
+        const std::size_t start = pos - entry.offset;
+        const pattern& pattern = *patterns_[entry.index];
+
+        if (pattern.size() > (size - start))
+            return false;
+
+        if (!pattern.match(base + start))
+            return false;
+
+        return func(static_cast<std::size_t>(entry.index), pointer(base + start));
+    }
+
+    template <typename Func>
+    inline void multi_scanner::operator()(region range, Func func) const
+    {
+        const byte* const base = range.start.as<const byte*>();
+        const std::size_t size = range.size;
+
+        if (!size || patterns_.empty())
+            return;
+
+        const std::uint64_t* const filter = filter_.data();
+
+        const anchor* const pairs_begin = pairs_.data();
+        const anchor* const pairs_end = pairs_begin + pairs_.size();
+
+        const anchor* const singles = singles_.data();
+        const std::uint32_t* const single_starts = single_starts_.data();
+
+        const bool has_unanchored = !unanchored_.empty();
+
+        for (std::size_t pos = 0; pos < size; ++pos)
+        {
+            if (MEM_UNLIKELY(has_unanchored))
+            {
+                for (std::uint32_t index : unanchored_)
+                {
+                    if (check({0, index, 0}, base, size, pos, func))
+                        return;
+                }
+            }
+
+            const std::uint32_t first = base[pos];
+
+            if (MEM_LIKELY(pos + 1 < size))
+            {
+                const std::uint32_t key = first | (static_cast<std::uint32_t>(base[pos + 1]) << 8);
+
+                if (MEM_LIKELY(!((filter[key >> 6] >> (key & 63)) & 1)))
+                    continue;
+
+                const anchor* entry = std::lower_bound(pairs_begin, pairs_end, key,
+                    [](const anchor& lhs, std::uint32_t rhs) { return lhs.key < rhs; });
+
+                for (; (entry != pairs_end) && (entry->key == key); ++entry)
+                {
+                    if (check(*entry, base, size, pos, func))
+                        return;
+                }
+            }
+
+            for (std::uint32_t i = single_starts[first], last = single_starts[first + 1]; i < last; ++i)
+            {
+                if (check(singles[i], base, size, pos, func))
+                    return;
+            }
+        }
+    }
+
+    inline std::vector<multi_result> multi_scanner::scan_all(region range) const
+    {
+        std::vector<multi_result> results;
+
+        (*this)(range, [&results](std::size_t index, pointer address) {
+            results.push_back({index, address});
+
+            return false;
+        });
+
+        std::sort(results.begin(), results.end(), [](const multi_result& lhs, const multi_result& rhs) {
+            return (lhs.address < rhs.address) || ((lhs.address == rhs.address) && (lhs.index < rhs.index));
+        });
+
+        return results;
+    }
+} // namespace mem
+
+#endif // MEM_MULTI_SCANNER_BRICK_H
@@ -0,0 +1,206 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_PARALLEL_SCANNER_BRICK_H
+#define MEM_PARALLEL_SCANNER_BRICK_H
+
+#include "pattern.h"
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+
+namespace mem
+{
+    namespace internal
+    {
+        // Joins its threads when destroyed, so an exception never destroys one which is still joinable
+        struct thread_group
+        {
+            std::vector<std::thread> threads {};
+
+            thread_group() = default;
+            thread_group(const thread_group&) = delete;
+            thread_group& operator=(const thread_group&) = delete;
+
+            ~thread_group();
+        };
+
+        // Splits the range into chunks of chunk_size, shared out between up to thread_count threads (0 uses one per
+        // core). Each chunk is extended by overlap bytes, and scan_chunk(chunk, limit, results) must only keep the
+        // matches starting before limit, so one crossing a boundary is found once. Returns the results in order.
+        template <typename Result, typename ScanChunk>
+        std::vector<Result> scan_in_chunks(
+            region range, std::size_t chunk_size, std::size_t overlap, std::size_t thread_count, ScanChunk scan_chunk);
+    } // namespace internal
+
+    template <typename Scanner = default_scanner>
+    class parallel_scanner : public scanner_base<parallel_scanner<Scanner>>
+    {
+    private:
+        Scanner scanner_ {};
+        std::size_t overlap_ {0};
+        std::size_t chunk_size_ {0};
+        std::size_t thread_count_ {0};
+
+    public:
+        static constexpr const std::size_t default_chunk_size {0x40000};
+
+        parallel_scanner() = default;
+
+        parallel_scanner(
+            pattern_view pattern, std::size_t thread_count = 0, std::size_t chunk_size = default_chunk_size);
+
+        pointer scan(region range) const;
+        pointer rscan(region range) const;
+
+        pattern_view get_pattern() const noexcept;
+
+        using scanner_base<parallel_scanner<Scanner>>::scan_all;
+
+        std::vector<pointer> scan_all(region range) const;
+    };
+
+    template <typename Scanner>
+    constexpr const std::size_t parallel_scanner<Scanner>::default_chunk_size;
+
+    template <typename Scanner>
+    inline parallel_scanner<Scanner>::parallel_scanner(
+        pattern_view _pattern, std::size_t thread_count, std::size_t chunk_size)
+        : scanner_(_pattern)
+        , overlap_(_pattern.size() ? (_pattern.size() - 1) : 0)
+        , chunk_size_(chunk_size ? chunk_size : default_chunk_size)
+        , thread_count_(thread_count)
+    {}
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE pointer parallel_scanner<Scanner>::scan(region range) const
+    {
+        return scanner_.scan(range);
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE pointer parallel_scanner<Scanner>::rscan(region range) const
+    {
+        return scanner_.rscan(range);
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE pattern_view parallel_scanner<Scanner>::get_pattern() const noexcept
+    {
+        return scanner_.get_pattern();
+    }
+
+    template <typename Scanner>
+    inline std::vector<pointer> parallel_scanner<Scanner>::scan_all(region range) const
+    {
+        return internal::scan_in_chunks<pointer>(range, chunk_size_, overlap_, thread_count_,
+            [this](region chunk, pointer limit, std::vector<pointer>& results) {
+                scanner_(chunk, [&results, limit](pointer result) {
+                    if (result >= limit)
+                        return true;
+
+                    results.push_back(result);
+
+                    return false;
+                });
+            });
+    }
+
+    namespace internal
+    {
+        inline thread_group::~thread_group()
+        {
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+
+        template <typename Result, typename ScanChunk>
+        inline std::vector<Result> scan_in_chunks(
+            region range, std::size_t chunk_size, std::size_t overlap, std::size_t thread_count, ScanChunk scan_chunk)
+        {
+            const std::size_t chunk_count = (range.size + chunk_size - 1) / chunk_size;
+
+            if (!thread_count)
+                thread_count = std::thread::hardware_concurrency();
+
+            if (thread_count > chunk_count)
+                thread_count = chunk_count;
+
+            std::vector<Result> merged;
+
+            if (thread_count <= 1)
+            {
+                scan_chunk(range, range.start + range.size, merged);
+
+                return merged;
+            }
+
+            std::vector<std::vector<Result>> results(chunk_count);
+            std::atomic<std::size_t> next {0};
+
+            const auto scan_chunks = [&] {
+                for (std::size_t index; (index = next.fetch_add(1)) < chunk_count;)
+                {
+                    const std::size_t start = index * chunk_size;
+                    const std::size_t end = (std::min)(start + chunk_size, range.size);
+                    const std::size_t scan_end = (std::min)(end + overlap, range.size);
+
+                    scan_chunk(region(range.start + start, scan_end - start), range.start + end, results[index]);
+                }
+            };
+
+            {
+                thread_group group;
+                group.threads.reserve(thread_count - 1);
+
+                for (std::size_t i = 1; i < thread_count; ++i)
+                {
+                    // Chunks are claimed as each thread becomes free, so any which could not start just leave more
+                    // for the others, including this one
+                    try
+                    {
+                        group.threads.emplace_back(scan_chunks);
+                    }
+                    catch (const std::system_error&)
+                    {
+                        break;
+                    }
+                }
+
+                scan_chunks();
+            }
+
+            std::size_t total = 0;
+
+            for (const std::vector<Result>& chunk_results : results)
+                total += chunk_results.size();
+
+            merged.reserve(total);
+
+            for (const std::vector<Result>& chunk_results : results)
+                merged.insert(merged.end(), chunk_results.begin(), chunk_results.end());
+
+            return merged;
+        }
+    } // namespace internal
+} // namespace mem
+
+#endif // MEM_PARALLEL_SCANNER_BRICK_H
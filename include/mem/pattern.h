@@ -23,26 +23,117 @@
 #include "char_queue.h"
 #include "mem.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <string>
 #include <vector>
 
+#if defined(MEM_SIMD_SSE2)
+#    include <emmintrin.h>
+#endif
+
 namespace mem
 {
+    // A relative displacement within a pattern, such as the rel32 of a call. It resolves to the address after the
+    // displacement and any trailing bytes of its instruction, plus the displacement.
+    struct pattern_capture
+    {
+        std::uint32_t offset;
+        std::uint16_t size;
+        std::uint16_t trailing;
+
+        pointer resolve(pointer address) const noexcept;
+
+        // Whether the capture lies within a pattern of pattern_size bytes, and has a size resolve can read
+        bool is_valid(std::size_t pattern_size) const noexcept;
+    };
+
+    // A non-owning view of a pattern's bytes and masks, such as a pattern or an entry of a signature_db.
+    // The bytes and masks must each be followed by padding_size zero bytes, so SIMD compares can load whole vectors.
+    class pattern_view
+    {
+    private:
+        const byte* bytes_ {nullptr};
+        const byte* masks_ {nullptr};
+        std::size_t size_ {0};
+        std::size_t trimmed_size_ {0};
+        bool needs_masks_ {false};
+
+        const pattern_capture* captures_ {nullptr};
+        std::size_t capture_count_ {0};
+
+    public:
+        static constexpr const std::size_t padding_size {32};
+
+        pattern_view() = default;
+
+        pattern_view(const byte* bytes, const byte* masks, std::size_t size, std::size_t trimmed_size,
+            bool needs_masks, const pattern_capture* captures = nullptr, std::size_t capture_count = 0) noexcept;
+
+        bool match(pointer address) const noexcept;
+
+        const byte* bytes() const noexcept;
+        const byte* masks() const noexcept;
+
+        std::size_t size() const noexcept;
+        std::size_t trimmed_size() const noexcept;
+
+        bool needs_masks() const noexcept;
+
+        const pattern_capture* captures() const noexcept;
+        std::size_t capture_count() const noexcept;
+
+        std::size_t get_skip_pos(const byte* frequencies) const noexcept;
+        std::size_t get_longest_run(std::size_t& length) const noexcept;
+
+        explicit operator bool() const noexcept;
+
+        std::string to_string() const;
+    };
+
+    constexpr const std::size_t pattern_view::padding_size;
+
     class pattern
     {
     private:
-        std::vector<byte> bytes_ {};
-        std::vector<byte> masks_ {};
+        static constexpr const std::size_t padding_size {pattern_view::padding_size};
+        static constexpr const std::size_t inline_size {32};
+
+        // The bytes, followed by the masks. Each is zero padded past size_, so SIMD compares can load whole vectors.
+        // Patterns of up to inline_size bytes are stored in inline_data_, without any heap allocation.
+        byte* data_ {nullptr};
+        std::size_t size_ {0};
         std::size_t trimmed_size_ {0};
         bool needs_masks_ {true};
 
+        byte inline_data_[(inline_size + padding_size) * 2];
+
+        std::vector<pattern_capture> captures_ {};
+
+        static constexpr std::size_t get_capacity(std::size_t size) noexcept;
+
+        void allocate(std::size_t size);
+        void release() noexcept;
+
+        byte* mutable_masks() noexcept;
+
         void finalize();
 
-        bool parse_chunk(char_queue& input, char wildcard);
+        static bool parse(const char* string, char wildcard, byte* bytes, byte* masks, std::size_t& size,
+            std::vector<pattern_capture>* captures);
 
     public:
         explicit pattern() = default;
 
+        pattern(const pattern& rhs);
+        pattern(pattern&& rhs) noexcept;
+
+        ~pattern();
+
+        pattern& operator=(const pattern& rhs);
+        pattern& operator=(pattern&& rhs) noexcept;
+
         enum class wildcard_t : char
         {
         };
@@ -51,6 +142,8 @@ namespace mem
         explicit pattern(const void* bytes, const char* masks, wildcard_t wildcard = static_cast<wildcard_t>('?'));
 
         explicit pattern(const void* bytes, const void* masks, std::size_t length);
+        explicit pattern(const void* bytes, const void* masks, std::size_t length, const pattern_capture* captures,
+            std::size_t capture_count);
 
         bool match(pointer address) const noexcept;
 
@@ -62,19 +155,40 @@ namespace mem
 
         bool needs_masks() const noexcept;
 
+        const std::vector<pattern_capture>& captures() const noexcept;
+
         std::size_t get_skip_pos(const byte* frequencies) const noexcept;
+        std::size_t get_longest_run(std::size_t& length) const noexcept;
 
         explicit operator bool() const noexcept;
 
         std::string to_string() const;
+
+        pattern_view view() const noexcept;
+        operator pattern_view() const noexcept;
     };
 
-    inline bool pattern::parse_chunk(char_queue& input, char wildcard)
+    namespace internal
+    {
+        // The largest pattern the parsers accept, so repeat counts and sizes can't overflow while parsing
+        constexpr const std::size_t max_pattern_size {0x1000000};
+
+        bool parse_chunk(char_queue& input, char wildcard, byte& value, byte& mask, std::size_t& count);
+        bool parse_capture(char_queue& input, std::size_t offset, pattern_capture& result);
+
+        template <typename T>
+        T load_word(const byte* data) noexcept;
+
+        bool match_bytes(const byte* data, const byte* bytes, std::size_t size) noexcept;
+        bool match_masked(const byte* data, const byte* bytes, const byte* masks, std::size_t size) noexcept;
+    } // namespace internal
+
+    inline bool internal::parse_chunk(char_queue& input, char wildcard, byte& value, byte& mask, std::size_t& count)
     {
-        byte value = 0x00;
-        byte mask = 0x00;
+        value = 0x00;
+        mask = 0x00;
 
-        std::size_t count = 1;
+        count = 1;
 
         int current = -1;
         int temp = -1;
@@ -109,46 +223,92 @@ namespace mem
 
             count = 0;
 
-            while (true)
+            while ((temp = dctoi(input.peek())) != -1)
             {
-                if ((temp = dctoi(input.peek())) != -1) { input.pop(); count = (count * 10) + static_cast<std::size_t>(temp); }
-                else if (count > 0)                     { break;                                                              }
-                else                                    { return false;                                                       }
+                input.pop();
+
+                if (count > (max_pattern_size - static_cast<std::size_t>(temp)) / 10)
+                    return false;
+
+                count = (count * 10) + static_cast<std::size_t>(temp);
             }
+
+            if (count == 0)
+                return false;
         }
         // clang-format on
 
         value &= mask;
 
-        for (std::size_t i = 0; i < count; ++i)
-        {
-            bytes_.push_back(value);
-            masks_.push_back(mask);
-        }
-
         return true;
     }
 
-    inline pattern::pattern(const char* string, wildcard_t wildcard)
+    // Parses "[rel8]" or "[rel32]", optionally followed by the number of trailing bytes, as in "[rel32+1]"
+    inline bool internal::parse_capture(char_queue& input, std::size_t offset, pattern_capture& result)
     {
-        char_queue input(string);
+        for (const char* prefix = "[rel"; *prefix; ++prefix)
+        {
+            if (input.peek() != *prefix)
+                return false;
 
-        while (input)
+            input.pop();
+        }
+
+        std::size_t bits = 0;
+        std::size_t trailing = 0;
+
+        int temp = -1;
+
+        while (((temp = dctoi(input.peek())) != -1) && (bits <= 32))
         {
-            if (input.peek() == ' ')
+            input.pop();
+
+            bits = (bits * 10) + static_cast<std::size_t>(temp);
+        }
+
+        if ((bits != 8) && (bits != 32))
+            return false;
+
+        if (input.peek() == '+')
+        {
+            input.pop();
+
+            if (dctoi(input.peek()) == -1)
+                return false;
+
+            while (((temp = dctoi(input.peek())) != -1) && (trailing <= UINT16_MAX))
             {
                 input.pop();
 
-                continue;
+                trailing = (trailing * 10) + static_cast<std::size_t>(temp);
             }
 
-            if (!parse_chunk(input, static_cast<char>(wildcard)))
-            {
-                masks_.clear();
-                bytes_.clear();
+            if (trailing > UINT16_MAX)
+                return false;
+        }
 
-                break;
-            }
+        if (input.peek() != ']')
+            return false;
+
+        input.pop();
+
+        result.offset = static_cast<std::uint32_t>(offset);
+        result.size = static_cast<std::uint16_t>(bits / 8);
+        result.trailing = static_cast<std::uint16_t>(trailing);
+
+        return true;
+    }
+
+    inline pattern::pattern(const char* string, wildcard_t wildcard)
+    {
+        std::size_t size = 0;
+
+        // Parse once to find the size, then again to fill in the bytes
+        if (parse(string, static_cast<char>(wildcard), nullptr, nullptr, size, nullptr))
+        {
+            allocate(size);
+
+            parse(string, static_cast<char>(wildcard), data_, mutable_masks(), size, &captures_);
         }
 
         finalize();
@@ -160,20 +320,21 @@ namespace mem
         {
             const std::size_t size = std::strlen(mask);
 
-            bytes_.resize(size);
-            masks_.resize(size);
+            allocate(size);
+
+            byte* const masks = mutable_masks();
 
             for (std::size_t i = 0; i < size; ++i)
             {
                 if (mask[i] == static_cast<char>(wildcard))
                 {
-                    bytes_[i] = 0x00;
-                    masks_[i] = 0x00;
+                    data_[i] = 0x00;
+                    masks[i] = 0x00;
                 }
                 else
                 {
-                    bytes_[i] = static_cast<const byte*>(bytes)[i];
-                    masks_[i] = 0xFF;
+                    data_[i] = static_cast<const byte*>(bytes)[i];
+                    masks[i] = 0xFF;
                 }
             }
         }
@@ -181,14 +342,10 @@ namespace mem
         {
             const std::size_t size = std::strlen(static_cast<const char*>(bytes));
 
-            bytes_.resize(size);
-            masks_.resize(size);
+            allocate(size);
 
-            for (std::size_t i = 0; i < size; ++i)
-            {
-                bytes_[i] = static_cast<const byte*>(bytes)[i];
-                masks_[i] = 0xFF;
-            }
+            std::memcpy(data_, bytes, size);
+            std::memset(mutable_masks(), 0xFF, size);
         }
 
         finalize();
@@ -196,212 +353,848 @@ namespace mem
 
     inline pattern::pattern(const void* bytes, const void* mask, std::size_t length)
     {
-        if (mask)
-        {
-            bytes_.resize(length);
-            masks_.resize(length);
-
-            for (std::size_t i = 0; i < length; ++i)
-            {
-                const byte v = static_cast<const byte*>(bytes)[i];
-                const byte m = static_cast<const byte*>(mask)[i];
+        allocate(length);
 
-                bytes_[i] = v & m;
-                masks_[i] = m;
-            }
-        }
-        else
+        if (length)
         {
-            bytes_.resize(length);
-            masks_.resize(length);
+            std::memcpy(data_, bytes, length);
 
-            for (std::size_t i = 0; i < length; ++i)
-            {
-                bytes_[i] = static_cast<const byte*>(bytes)[i];
-                masks_[i] = 0xFF;
-            }
+            if (mask)
+                std::memcpy(mutable_masks(), mask, length);
+            else
+                std::memset(mutable_masks(), 0xFF, length);
         }
 
         finalize();
     }
 
-    inline void pattern::finalize()
+    inline pattern::pattern(const void* bytes, const void* masks, std::size_t length, const pattern_capture* captures,
+        std::size_t capture_count)
+        : pattern(bytes, masks, length)
     {
-        if (bytes_.size() != masks_.size())
+        for (std::size_t i = 0; i < capture_count; ++i)
         {
-            bytes_.clear();
-            masks_.clear();
-            trimmed_size_ = 0;
-            needs_masks_ = false;
-
-            return;
-        }
+            // Captures outside of the pattern would resolve from outside of the match
+            if (!captures[i].is_valid(length))
+            {
+                *this = pattern();
 
-        for (std::size_t i = 0; i < bytes_.size(); ++i)
-        {
-            bytes_[i] &= masks_[i];
+                return;
+            }
         }
 
-        std::size_t trimmed_size = bytes_.size();
+        captures_.assign(captures, captures + capture_count);
+    }
 
-        while (trimmed_size && (masks_[trimmed_size - 1] == 0x00))
+    inline pattern::pattern(const pattern& rhs)
+        : size_(rhs.size_)
+        , trimmed_size_(rhs.trimmed_size_)
+        , needs_masks_(rhs.needs_masks_)
+        , captures_(rhs.captures_)
+    {
+        if (rhs.data_)
         {
-            --trimmed_size;
-        }
-
-        trimmed_size_ = trimmed_size;
+            const std::size_t capacity = get_capacity(size_);
 
-        needs_masks_ = false;
-
-        for (std::size_t i = trimmed_size_; i--;)
-        {
-            if (masks_[i] != 0xFF)
-            {
-                needs_masks_ = true;
+            data_ = (size_ <= inline_size) ? inline_data_ : new byte[capacity];
 
-                break;
-            }
+            std::memcpy(data_, rhs.data_, capacity);
         }
     }
 
-    inline bool pattern::match(pointer address) const noexcept
+    inline pattern::pattern(pattern&& rhs) noexcept
+        : size_(rhs.size_)
+        , trimmed_size_(rhs.trimmed_size_)
+        , needs_masks_(rhs.needs_masks_)
+        , captures_(std::move(rhs.captures_))
     {
-        const byte* const pat_bytes = bytes();
+        if (rhs.data_ == rhs.inline_data_)
+        {
+            data_ = inline_data_;
 
-        if (!pat_bytes)
+            std::memcpy(inline_data_, rhs.inline_data_, get_capacity(size_));
+        }
+        else
         {
-            return false;
+            data_ = rhs.data_;
         }
 
-        const byte* current = address.as<const byte*>();
+        rhs.data_ = nullptr;
+        rhs.size_ = 0;
+        rhs.trimmed_size_ = 0;
+        rhs.needs_masks_ = false;
+    }
 
-        const std::size_t last = trimmed_size() - 1;
+    inline pattern::~pattern()
+    {
+        release();
+    }
 
-        if (needs_masks())
+    inline pattern& pattern::operator=(const pattern& rhs)
+    {
+        if (this != &rhs)
+            *this = pattern(rhs);
+
+        return *this;
+    }
+
+    inline pattern& pattern::operator=(pattern&& rhs) noexcept
+    {
+        if (this != &rhs)
         {
-            const byte* const pat_masks = masks();
+            release();
 
-            for (std::size_t i = last; MEM_LIKELY((current[i] & pat_masks[i]) != pat_bytes[i]); --i)
+            size_ = rhs.size_;
+            trimmed_size_ = rhs.trimmed_size_;
+            needs_masks_ = rhs.needs_masks_;
+            captures_ = std::move(rhs.captures_);
+
+            if (rhs.data_ == rhs.inline_data_)
             {
-                if (MEM_UNLIKELY(i == 0))
-                    return true;
-            }
+                data_ = inline_data_;
 
-            return false;
-        }
-        else
-        {
-            for (std::size_t i = last; MEM_LIKELY(current[i] != pat_bytes[i]); --i)
+                std::memcpy(inline_data_, rhs.inline_data_, get_capacity(size_));
+            }
+            else
             {
-                if (MEM_UNLIKELY(i == 0))
-                    return true;
+                data_ = rhs.data_;
             }
 
-            return false;
+            rhs.data_ = nullptr;
+            rhs.size_ = 0;
+            rhs.trimmed_size_ = 0;
+            rhs.needs_masks_ = false;
         }
-    }
 
-    MEM_STRONG_INLINE const byte* pattern::bytes() const noexcept
-    {
-        return !bytes_.empty() ? bytes_.data() : nullptr;
+        return *this;
     }
 
-    MEM_STRONG_INLINE const byte* pattern::masks() const noexcept
+    MEM_STRONG_INLINE constexpr std::size_t pattern::get_capacity(std::size_t size) noexcept
     {
-        return !masks_.empty() ? masks_.data() : nullptr;
+        return (size + padding_size) * 2;
     }
 
-    MEM_STRONG_INLINE std::size_t pattern::size() const noexcept
+    inline void pattern::allocate(std::size_t size)
     {
-        return bytes_.size();
+        const std::size_t capacity = get_capacity(size);
+
+        data_ = (size <= inline_size) ? inline_data_ : new byte[capacity];
+        size_ = size;
+
+        std::memset(data_, 0x00, capacity);
     }
 
-    MEM_STRONG_INLINE std::size_t pattern::trimmed_size() const noexcept
+    inline void pattern::release() noexcept
     {
-        return trimmed_size_;
+        if (data_ != inline_data_)
+            delete[] data_;
+
+        data_ = nullptr;
     }
 
-    MEM_STRONG_INLINE bool pattern::needs_masks() const noexcept
+    MEM_STRONG_INLINE byte* pattern::mutable_masks() noexcept
     {
-        return needs_masks_;
+        return data_ + size_ + padding_size;
     }
 
-    MEM_STRONG_INLINE std::size_t pattern::get_skip_pos(const byte* frequencies) const noexcept
+    inline bool pattern::parse(const char* string, char wildcard, byte* bytes, byte* masks, std::size_t& size,
+        std::vector<pattern_capture>* captures)
     {
-        std::size_t min = SIZE_MAX;
-        std::size_t result = SIZE_MAX;
+        char_queue input(string);
 
-        for (std::size_t i = 0; i < size(); ++i)
+        size = 0;
+
+        while (input)
         {
-            if (masks_[i] == 0xFF)
+            if (input.peek() == ' ')
             {
-                std::size_t f = frequencies[bytes_[i]];
+                input.pop();
 
-                if (f <= min)
+                continue;
+            }
+
+            if (input.peek() == '[')
+            {
+                pattern_capture capture;
+
+                if (!internal::parse_capture(input, size, capture) ||
+                    (capture.size > internal::max_pattern_size - size))
+                    return false;
+
+                // The displacement itself is a wildcard
+                if (bytes)
                 {
-                    result = i;
-                    min = f;
+                    std::memset(bytes + size, 0x00, capture.size);
+                    std::memset(masks + size, 0x00, capture.size);
+
+                    captures->push_back(capture);
                 }
+
+                size += capture.size;
+
+                continue;
+            }
+
+            byte value = 0x00;
+            byte mask = 0x00;
+
+            std::size_t count = 1;
+
+            if (!internal::parse_chunk(input, wildcard, value, mask, count) ||
+                (count > internal::max_pattern_size - size))
+                return false;
+
+            if (bytes)
+            {
+                std::memset(bytes + size, value, count);
+                std::memset(masks + size, mask, count);
             }
+
+            size += count;
         }
 
-        return result;
+        return true;
     }
 
-    MEM_STRONG_INLINE pattern::operator bool() const noexcept
+    inline void pattern::finalize()
     {
-        return !bytes_.empty() && !masks_.empty();
-    }
+        if (!size_)
+        {
+            release();
 
-    inline std::string pattern::to_string() const
-    {
-        const char* const hex_chars = "0123456789ABCDEF";
+            trimmed_size_ = 0;
+            needs_masks_ = false;
 
-        std::string result;
+            return;
+        }
 
-        for (std::size_t i = 0; i < size(); ++i)
+        byte* const bytes = data_;
+        const byte* const masks = mutable_masks();
+
+        for (std::size_t i = 0; i < size_; ++i)
         {
-            if (i)
-            {
-                result += ' ';
-            }
+            bytes[i] &= masks[i];
+        }
 
-            const byte mask = masks_[i];
-            const byte value = bytes_[i];
+        std::size_t trimmed_size = size_;
 
-            if (mask != 0x00)
-            {
-                result += hex_chars[static_cast<std::size_t>(value >> 4)];
-                result += hex_chars[static_cast<std::size_t>(value & 0xF)];
+        while (trimmed_size && (masks[trimmed_size - 1] == 0x00))
+        {
+            --trimmed_size;
+        }
 
-                if (mask != 0xFF)
-                {
-                    result += '&';
-                    result += hex_chars[static_cast<std::size_t>(mask >> 4)];
-                    result += hex_chars[static_cast<std::size_t>(mask & 0xF)];
-                }
-            }
-            else
+        trimmed_size_ = trimmed_size;
+
+        needs_masks_ = false;
+
+        for (std::size_t i = trimmed_size_; i--;)
+        {
+            if (masks[i] != 0xFF)
             {
-                result += '?';
+                needs_masks_ = true;
+
+                break;
             }
         }
+    }
+
+#if defined(MEM_SIMD_SSE2)
+#    define l_SIMD_LOAD(x) _mm_loadu_si128(reinterpret_cast<const __m128i*>(x))
+#    define l_SIMD_EQUAL(x, y) static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)))
+#    define l_SIMD_MATCH(data, bytes) l_SIMD_EQUAL(l_SIMD_LOAD(data), l_SIMD_LOAD(bytes))
+#    define l_SIMD_MATCH_MASKED(data, bytes, masks) \
+        l_SIMD_EQUAL(_mm_and_si128(l_SIMD_LOAD(data), l_SIMD_LOAD(masks)), l_SIMD_LOAD(bytes))
+#endif
 
+    template <typename T>
+    MEM_STRONG_INLINE T internal::load_word(const byte* data) noexcept
+    {
+        T result;
+        std::memcpy(&result, data, sizeof(result));
         return result;
     }
 
-    template <typename Scanner>
-    class scanner_base
+    // Patterns are padded, but the data being compared is not, so no load may go past data + size. Compares which are
+    // not a whole number of blocks finish on a block overlapping the previous one.
+    MEM_STRONG_INLINE bool internal::match_bytes(const byte* data, const byte* bytes, std::size_t size) noexcept
     {
-    public:
-        pointer operator()(region range) const;
+#if defined(MEM_SIMD_SSE2)
+        if (size >= 16)
+        {
+            const std::size_t last = size - 16;
 
-        template <typename Func>
-        pointer operator()(region range, Func func) const;
+            for (std::size_t i = 0; i < last; i += 16)
+            {
+                if (l_SIMD_MATCH(data + i, bytes + i) != 0xFFFF)
+                    return false;
+            }
+
+            return l_SIMD_MATCH(data + last, bytes + last) == 0xFFFF;
+        }
+#endif
+
+        if (size >= 8)
+        {
+            const std::size_t last = size - 8;
+
+            for (std::size_t i = 0; i < last; i += 8)
+            {
+                if (load_word<std::uint64_t>(data + i) != load_word<std::uint64_t>(bytes + i))
+                    return false;
+            }
+
+            return load_word<std::uint64_t>(data + last) == load_word<std::uint64_t>(bytes + last);
+        }
+
+        if (size >= 4)
+        {
+            const std::size_t last = size - 4;
+
+            return (load_word<std::uint32_t>(data) == load_word<std::uint32_t>(bytes)) &&
+                (load_word<std::uint32_t>(data + last) == load_word<std::uint32_t>(bytes + last));
+        }
+
+        for (std::size_t i = size; i--;)
+        {
+            if (data[i] != bytes[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    MEM_STRONG_INLINE bool internal::match_masked(
+        const byte* data, const byte* bytes, const byte* masks, std::size_t size) noexcept
+    {
+#if defined(MEM_SIMD_SSE2)
+        if (size >= 16)
+        {
+            const std::size_t last = size - 16;
+
+            for (std::size_t i = 0; i < last; i += 16)
+            {
+                if (l_SIMD_MATCH_MASKED(data + i, bytes + i, masks + i) != 0xFFFF)
+                    return false;
+            }
+
+            return l_SIMD_MATCH_MASKED(data + last, bytes + last, masks + last) == 0xFFFF;
+        }
+#endif
+
+        if (size >= 8)
+        {
+            const std::size_t last = size - 8;
+
+            for (std::size_t i = 0; i < last; i += 8)
+            {
+                if ((load_word<std::uint64_t>(data + i) & load_word<std::uint64_t>(masks + i)) !=
+                    load_word<std::uint64_t>(bytes + i))
+                    return false;
+            }
+
+            return (load_word<std::uint64_t>(data + last) & load_word<std::uint64_t>(masks + last)) ==
+                load_word<std::uint64_t>(bytes + last);
+        }
+
+        if (size >= 4)
+        {
+            const std::size_t last = size - 4;
+
+            return ((load_word<std::uint32_t>(data) & load_word<std::uint32_t>(masks)) ==
+                       load_word<std::uint32_t>(bytes)) &&
+                ((load_word<std::uint32_t>(data + last) & load_word<std::uint32_t>(masks + last)) ==
+                    load_word<std::uint32_t>(bytes + last));
+        }
+
+        for (std::size_t i = size; i--;)
+        {
+            if ((data[i] & masks[i]) != bytes[i])
+                return false;
+        }
+
+        return true;
+    }
+
+#if defined(MEM_SIMD_SSE2)
+#    undef l_SIMD_LOAD
+#    undef l_SIMD_EQUAL
+#    undef l_SIMD_MATCH
+#    undef l_SIMD_MATCH_MASKED
+#endif
+
+    MEM_STRONG_INLINE pointer pattern_capture::resolve(pointer address) const noexcept
+    {
+        const byte* const field = address.as<const byte*>() + offset;
+
+        std::int32_t displacement = 0;
+
+        if (size == 1)
+            displacement = static_cast<std::int8_t>(*field);
+        else
+            std::memcpy(&displacement, field, sizeof(displacement));
+
+        const std::size_t end = offset + size + trailing;
+
+        return address + end + static_cast<std::size_t>(static_cast<std::ptrdiff_t>(displacement));
+    }
+
+    MEM_STRONG_INLINE bool pattern_capture::is_valid(std::size_t pattern_size) const noexcept
+    {
+        return ((size == 1) || (size == 4)) && (offset <= pattern_size) && (size <= pattern_size - offset) &&
+            (trailing <= SIZE_MAX - offset - size);
+    }
+
+    MEM_STRONG_INLINE pattern_view::pattern_view(const byte* bytes, const byte* masks, std::size_t size,
+        std::size_t trimmed_size, bool needs_masks, const pattern_capture* captures, std::size_t capture_count) noexcept
+        : bytes_(bytes)
+        , masks_(masks)
+        , size_(size)
+        , trimmed_size_(trimmed_size)
+        , needs_masks_(needs_masks)
+        , captures_(captures)
+        , capture_count_(capture_count)
+    {}
+
+    inline bool pattern_view::match(pointer address) const noexcept
+    {
+        const byte* const pat_bytes = bytes();
+
+        if (!pat_bytes)
+        {
+            return false;
+        }
+
+        const byte* current = address.as<const byte*>();
+
+        if (needs_masks())
+        {
+            return internal::match_masked(current, pat_bytes, masks(), trimmed_size());
+        }
+        else
+        {
+            return internal::match_bytes(current, pat_bytes, trimmed_size());
+        }
+    }
+
+    MEM_STRONG_INLINE const byte* pattern_view::bytes() const noexcept
+    {
+        return bytes_;
+    }
+
+    MEM_STRONG_INLINE const byte* pattern_view::masks() const noexcept
+    {
+        return masks_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern_view::size() const noexcept
+    {
+        return size_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern_view::trimmed_size() const noexcept
+    {
+        return trimmed_size_;
+    }
+
+    MEM_STRONG_INLINE bool pattern_view::needs_masks() const noexcept
+    {
+        return needs_masks_;
+    }
+
+    MEM_STRONG_INLINE const pattern_capture* pattern_view::captures() const noexcept
+    {
+        return captures_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern_view::capture_count() const noexcept
+    {
+        return capture_count_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern_view::get_skip_pos(const byte* frequencies) const noexcept
+    {
+        const byte* const pat_bytes = bytes();
+        const byte* const pat_masks = masks();
+
+        std::size_t min = SIZE_MAX;
+        std::size_t result = SIZE_MAX;
+
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            if (pat_masks[i] == 0xFF)
+            {
+                std::size_t f = frequencies[pat_bytes[i]];
+
+                if (f <= min)
+                {
+                    result = i;
+                    min = f;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    inline std::size_t pattern_view::get_longest_run(std::size_t& length) const noexcept
+    {
+        std::size_t max_skip = 0;
+        std::size_t skip_pos = 0;
+
+        std::size_t current_skip = 0;
+
+        const byte* const pat_masks = masks();
+
+        for (std::size_t i = 0; i < trimmed_size_; ++i)
+        {
+            if (pat_masks[i] != 0xFF)
+            {
+                if (current_skip > max_skip)
+                {
+                    max_skip = current_skip;
+                    skip_pos = i - current_skip;
+                }
+
+                current_skip = 0;
+            }
+            else
+            {
+                ++current_skip;
+            }
+        }
+
+        if (current_skip > max_skip)
+        {
+            max_skip = current_skip;
+            skip_pos = trimmed_size_ - current_skip;
+        }
+
+        length = max_skip;
+
+        return skip_pos;
+    }
+
+    MEM_STRONG_INLINE pattern_view::operator bool() const noexcept
+    {
+        return size_ != 0;
+    }
+
+    inline std::string pattern_view::to_string() const
+    {
+        const char* const hex_chars = "0123456789ABCDEF";
+
+        std::string result;
+
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            if (i)
+            {
+                result += ' ';
+            }
+
+            const pattern_capture* capture = std::find_if(captures_, captures_ + capture_count_,
+                [i](const pattern_capture& entry) { return entry.offset == i; });
+
+            if (capture != captures_ + capture_count_)
+            {
+                result += "[rel";
+                result += std::to_string(capture->size * 8);
+
+                if (capture->trailing)
+                {
+                    result += '+';
+                    result += std::to_string(capture->trailing);
+                }
+
+                result += ']';
+
+                i += capture->size - 1u;
+
+                continue;
+            }
+
+            const byte mask = masks()[i];
+            const byte value = bytes()[i];
+
+            if (mask != 0x00)
+            {
+                result += hex_chars[static_cast<std::size_t>(value >> 4)];
+                result += hex_chars[static_cast<std::size_t>(value & 0xF)];
+
+                if (mask != 0xFF)
+                {
+                    result += '&';
+                    result += hex_chars[static_cast<std::size_t>(mask >> 4)];
+                    result += hex_chars[static_cast<std::size_t>(mask & 0xF)];
+                }
+            }
+            else
+            {
+                result += '?';
+            }
+        }
+
+        return result;
+    }
+
+    MEM_STRONG_INLINE bool pattern::match(pointer address) const noexcept
+    {
+        return view().match(address);
+    }
+
+    MEM_STRONG_INLINE const byte* pattern::bytes() const noexcept
+    {
+        return size_ ? data_ : nullptr;
+    }
+
+    MEM_STRONG_INLINE const byte* pattern::masks() const noexcept
+    {
+        return size_ ? (data_ + size_ + padding_size) : nullptr;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern::size() const noexcept
+    {
+        return size_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern::trimmed_size() const noexcept
+    {
+        return trimmed_size_;
+    }
+
+    MEM_STRONG_INLINE bool pattern::needs_masks() const noexcept
+    {
+        return needs_masks_;
+    }
+
+    MEM_STRONG_INLINE const std::vector<pattern_capture>& pattern::captures() const noexcept
+    {
+        return captures_;
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern::get_skip_pos(const byte* frequencies) const noexcept
+    {
+        return view().get_skip_pos(frequencies);
+    }
+
+    MEM_STRONG_INLINE std::size_t pattern::get_longest_run(std::size_t& length) const noexcept
+    {
+        return view().get_longest_run(length);
+    }
+
+    MEM_STRONG_INLINE pattern::operator bool() const noexcept
+    {
+        return size_ != 0;
+    }
+
+    inline std::string pattern::to_string() const
+    {
+        return view().to_string();
+    }
+
+    MEM_STRONG_INLINE pattern_view pattern::view() const noexcept
+    {
+        return pattern_view(bytes(), masks(), size_, trimmed_size_, needs_masks_, captures_.data(), captures_.size());
+    }
+
+    MEM_STRONG_INLINE pattern::operator pattern_view() const noexcept
+    {
+        return view();
+    }
+
+    template <typename Scanner>
+    class scan_iterator
+    {
+    private:
+        // Matches are found in batches through the callback form of the scanner, which keeps its state between them
+        static constexpr const std::size_t batch_size {16};
+
+        const Scanner* scanner_ {nullptr};
+
+        // The part of the range after the current batch
+        region range_ {};
+
+        mem::pointer batch_[batch_size] {};
+        std::size_t index_ {0};
+        std::size_t count_ {0};
+
+        mem::pointer current_ {nullptr};
+
+        void fill();
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = mem::pointer;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        scan_iterator() = default;
+
+        scan_iterator(const Scanner* scanner, region range);
+
+        reference operator*() const noexcept;
+        pointer operator->() const noexcept;
+
+        scan_iterator& operator++();
+        scan_iterator operator++(int);
+
+        bool operator==(const scan_iterator& rhs) const noexcept;
+        bool operator!=(const scan_iterator& rhs) const noexcept;
+    };
+
+    template <typename Scanner>
+    class scan_range
+    {
+    private:
+        const Scanner* scanner_ {nullptr};
+        region range_ {};
+
+    public:
+        scan_range(const Scanner* scanner, region range) noexcept;
+
+        scan_iterator<Scanner> begin() const;
+        scan_iterator<Scanner> end() const noexcept;
+    };
+
+    // The matches of a pattern, along with the targets of its captures.
+    // The target of capture j for match i is targets[(i * stride) + j].
+    struct capture_results
+    {
+        std::vector<pointer> addresses {};
+        std::vector<pointer> targets {};
+        std::size_t stride {0};
+    };
+
+    capture_results resolve_captures(pattern_view pattern, const std::vector<pointer>& addresses);
+
+    template <typename Scanner>
+    class scanner_base
+    {
+    public:
+        pointer operator()(region range) const;
+
+        template <typename Func>
+        pointer operator()(region range, Func func) const;
 
         std::vector<pointer> scan_all(region range) const;
+
+        template <typename OutputIt>
+        OutputIt scan_all(region range, OutputIt output) const;
+
+        // Lazily scans for each match as the range is iterated
+        scan_range<Scanner> matches(region range) const noexcept;
+
+        std::size_t count(region range) const;
+
+        std::vector<pointer> first_n(region range, std::size_t n) const;
+
+        template <typename OutputIt>
+        OutputIt first_n(region range, std::size_t n, OutputIt output) const;
+
+        // Scans backwards from the end of the range, using Scanner::rscan
+        pointer scan_last(region range) const;
+
+        // Resolves the captures of Scanner::get_pattern() at each match, while its bytes are still cached
+        capture_results scan_captures(region range) const;
     };
 
+    template <typename Scanner>
+    constexpr const std::size_t scan_iterator<Scanner>::batch_size;
+
+    template <typename Scanner>
+    inline scan_iterator<Scanner>::scan_iterator(const Scanner* scanner, region range)
+        : scanner_(scanner)
+        , range_(range)
+    {
+        fill();
+    }
+
+    template <typename Scanner>
+    inline void scan_iterator<Scanner>::fill()
+    {
+        mem::pointer* const batch = batch_;
+        std::size_t count = 0;
+
+        if (range_.size)
+        {
+            const mem::pointer last = (*scanner_)(range_, [batch, &count](mem::pointer result) {
+                batch[count++] = result;
+
+                return count == batch_size;
+            });
+
+            range_ = last ? range_.sub_region(last + 1) : region();
+        }
+
+        index_ = 0;
+        count_ = count;
+        current_ = count ? batch[0] : nullptr;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE typename scan_iterator<Scanner>::reference scan_iterator<Scanner>::operator*() const noexcept
+    {
+        return current_;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE typename scan_iterator<Scanner>::pointer scan_iterator<Scanner>::operator->() const noexcept
+    {
+        return &current_;
+    }
+
+    template <typename Scanner>
+    inline scan_iterator<Scanner>& scan_iterator<Scanner>::operator++()
+    {
+        if (++index_ < count_)
+            current_ = batch_[index_];
+        else
+            fill();
+
+        return *this;
+    }
+
+    template <typename Scanner>
+    inline scan_iterator<Scanner> scan_iterator<Scanner>::operator++(int)
+    {
+        scan_iterator result = *this;
+
+        ++*this;
+
+        return result;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE bool scan_iterator<Scanner>::operator==(const scan_iterator& rhs) const noexcept
+    {
+        return current_ == rhs.current_;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE bool scan_iterator<Scanner>::operator!=(const scan_iterator& rhs) const noexcept
+    {
+        return current_ != rhs.current_;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE scan_range<Scanner>::scan_range(const Scanner* scanner, region range) noexcept
+        : scanner_(scanner)
+        , range_(range)
+    {}
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE scan_iterator<Scanner> scan_range<Scanner>::begin() const
+    {
+        return scan_iterator<Scanner>(scanner_, range_);
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE scan_iterator<Scanner> scan_range<Scanner>::end() const noexcept
+    {
+        return scan_iterator<Scanner>();
+    }
+
     template <typename Scanner>
     MEM_STRONG_INLINE pointer scanner_base<Scanner>::operator()(region range) const
     {
@@ -439,14 +1232,111 @@ namespace mem
     {
         std::vector<pointer> results;
 
-        (*this)(range, [&results](pointer result) {
-            results.emplace_back(result);
+        scan_all(range, std::back_inserter(results));
+
+        return results;
+    }
+
+    template <typename Scanner>
+    template <typename OutputIt>
+    inline OutputIt scanner_base<Scanner>::scan_all(region range, OutputIt output) const
+    {
+        (*static_cast<const Scanner*>(this))(range, [&output](pointer result) {
+            *output++ = result;
+
+            return false;
+        });
+
+        return output;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE scan_range<Scanner> scanner_base<Scanner>::matches(region range) const noexcept
+    {
+        return scan_range<Scanner>(static_cast<const Scanner*>(this), range);
+    }
+
+    template <typename Scanner>
+    inline std::size_t scanner_base<Scanner>::count(region range) const
+    {
+        std::size_t result = 0;
+
+        (*static_cast<const Scanner*>(this))(range, [&result](pointer) {
+            ++result;
+
+            return false;
+        });
+
+        return result;
+    }
+
+    template <typename Scanner>
+    inline std::vector<pointer> scanner_base<Scanner>::first_n(region range, std::size_t n) const
+    {
+        std::vector<pointer> results;
+
+        first_n(range, n, std::back_inserter(results));
+
+        return results;
+    }
+
+    template <typename Scanner>
+    template <typename OutputIt>
+    inline OutputIt scanner_base<Scanner>::first_n(region range, std::size_t n, OutputIt output) const
+    {
+        if (!n)
+            return output;
+
+        (*static_cast<const Scanner*>(this))(range, [&output, &n](pointer result) {
+            *output++ = result;
+
+            return --n == 0;
+        });
+
+        return output;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE pointer scanner_base<Scanner>::scan_last(region range) const
+    {
+        return static_cast<const Scanner*>(this)->rscan(range);
+    }
+
+    template <typename Scanner>
+    inline capture_results scanner_base<Scanner>::scan_captures(region range) const
+    {
+        const pattern_view pattern = static_cast<const Scanner*>(this)->get_pattern();
+
+        capture_results results;
+        results.stride = pattern.capture_count();
+
+        (*static_cast<const Scanner*>(this))(range, [&results, &pattern](pointer result) {
+            results.addresses.push_back(result);
+
+            for (std::size_t i = 0; i < results.stride; ++i)
+                results.targets.push_back(pattern.captures()[i].resolve(result));
 
             return false;
         });
 
         return results;
     }
+
+    inline capture_results resolve_captures(pattern_view pattern, const std::vector<pointer>& addresses)
+    {
+        capture_results results;
+        results.addresses = addresses;
+        results.stride = pattern.capture_count();
+        results.targets.reserve(addresses.size() * results.stride);
+
+        for (pointer address : addresses)
+        {
+            for (std::size_t i = 0; i < results.stride; ++i)
+                results.targets.push_back(pattern.captures()[i].resolve(address));
+        }
+
+        return results;
+    }
 } // namespace mem
 
 #include "simd_scanner.h"
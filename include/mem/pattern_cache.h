@@ -21,8 +21,11 @@
 #define MEM_PATTERN_CACHE_BRICK_H
 
 #include "hasher.h"
+#include "multi_scanner.h"
+#include "parallel_scanner.h"
 #include "pattern.h"
 
+#include <cstring>
 #include <unordered_map>
 
 #include <istream>
@@ -35,45 +38,123 @@ namespace mem
     private:
         struct pattern_results
         {
+            // The bytes of the pattern followed by its masks, so a matching hash can be verified
+            std::vector<byte> pattern {};
+
             std::vector<pointer> results {};
             bool checked {false};
         };
 
+        using results_map = std::unordered_map<std::uint64_t, pattern_results>;
+
         region region_;
-        std::unordered_map<std::uint32_t, pattern_results> results_;
+        results_map results_;
+
+        static std::uint64_t hash_pattern(const pattern& pattern);
 
-        static std::uint32_t hash_pattern(const pattern& pattern);
+        static std::vector<byte> pack_pattern(const pattern& pattern);
+        static bool same_pattern(const pattern_results& results, const pattern& pattern);
+
+        // Returns the entry for the pattern, or end() with hash set to the key it should be stored under
+        results_map::iterator find_results(const pattern& pattern, std::uint64_t& hash);
+
+        bool still_matches(const pattern_results& results, const pattern& pattern) const;
 
     public:
+        static constexpr const std::size_t resolve_chunk_size {0x40000};
+
         pattern_cache(region range);
 
         pointer scan(const pattern& pattern, std::size_t index = 0, std::size_t expected = 1);
         const std::vector<pointer>& scan_all(const pattern& pattern);
 
+        // Scans for every pattern which is not cached, or whose cached results no longer match, in a single pass.
+        // A thread count of 0 uses one thread per core.
+        void resolve(const std::vector<pattern>& patterns, std::size_t thread_count = 1);
+
         void save(std::ostream& output) const;
         bool load(std::istream& input);
     };
 
-    inline std::uint32_t pattern_cache::hash_pattern(const pattern& pattern)
+    inline std::uint64_t pattern_cache::hash_pattern(const pattern& pattern)
     {
-        hasher hash;
+        hasher64 hash;
 
         std::size_t length = pattern.size();
 
         hash.update(length);
 
-        const byte* bytes = pattern.bytes();
-        const byte* masks = pattern.masks();
+        hash.update(pattern.bytes(), length);
+        hash.update(pattern.masks(), length);
+
+        return hash.digest();
+    }
 
-        hash.update(0x435E89AB7);
-        hash.update(bytes, length);
+    inline std::vector<byte> pattern_cache::pack_pattern(const pattern& pattern)
+    {
+        const std::size_t length = pattern.size();
 
-        hash.update(0xAE1E9528);
-        hash.update(masks, length);
+        std::vector<byte> result(length * 2);
 
-        return hash.digest();
+        if (length)
+        {
+            std::memcpy(result.data(), pattern.bytes(), length);
+            std::memcpy(result.data() + length, pattern.masks(), length);
+        }
+
+        return result;
+    }
+
+    inline bool pattern_cache::same_pattern(const pattern_results& results, const pattern& pattern)
+    {
+        const std::size_t length = pattern.size();
+
+        if (results.pattern.size() != (length * 2))
+            return false;
+
+        return !length ||
+            (!std::memcmp(results.pattern.data(), pattern.bytes(), length) &&
+                !std::memcmp(results.pattern.data() + length, pattern.masks(), length));
+    }
+
+    inline pattern_cache::results_map::iterator pattern_cache::find_results(
+        const pattern& pattern, std::uint64_t& hash)
+    {
+        hash = hash_pattern(pattern);
+
+        auto find = results_.find(hash);
+
+        // Patterns with colliding hashes are stored under the next free key
+        while ((find != results_.end()) && !same_pattern(find->second, pattern))
+            find = results_.find(++hash);
+
+        return find;
     }
 
+    inline bool pattern_cache::still_matches(const pattern_results& results, const pattern& pattern) const
+    {
+        const std::size_t length = pattern.size();
+
+        if (length > region_.size)
+            return results.results.empty();
+
+        for (pointer result : results.results)
+        {
+            if (result < region_.start)
+                return false;
+
+            if (static_cast<std::size_t>(result - region_.start) > (region_.size - length))
+                return false;
+
+            if (!pattern.match(result))
+                return false;
+        }
+
+        return true;
+    }
+
+    constexpr const std::size_t pattern_cache::resolve_chunk_size;
+
     inline pattern_cache::pattern_cache(region range)
         : region_(range)
     {}
@@ -97,37 +178,23 @@ namespace mem
 
     inline const std::vector<pointer>& pattern_cache::scan_all(const pattern& pattern)
     {
-        const std::uint32_t hash = hash_pattern(pattern);
+        std::uint64_t hash;
 
-        auto find = results_.find(hash);
+        auto find = find_results(pattern, hash);
 
         if (find != results_.end())
         {
-            if (!find->second.checked)
+            if (!find->second.checked && !still_matches(find->second, pattern))
             {
-                bool changed = false;
+                default_scanner scanner(pattern);
 
-                for (pointer result : find->second.results)
-                {
-                    if (!pattern.match(result))
-                    {
-                        changed = true;
-
-                        break;
-                    }
-                }
-
-                if (changed)
-                {
-                    default_scanner scanner(pattern);
-
-                    find->second.results = scanner.scan_all(region_);
-                }
+                find->second.results = scanner.scan_all(region_);
             }
         }
         else
         {
             pattern_results results;
+            results.pattern = pack_pattern(pattern);
 
             default_scanner scanner(pattern);
             results.results = scanner.scan_all(region_);
@@ -140,6 +207,70 @@ namespace mem
         return find->second.results;
     }
 
+    inline void pattern_cache::resolve(const std::vector<pattern>& patterns, std::size_t thread_count)
+    {
+        std::vector<pattern> pending;
+        std::vector<pattern_results*> entries;
+
+        for (const pattern& pattern : patterns)
+        {
+            std::uint64_t hash;
+
+            auto find = find_results(pattern, hash);
+
+            if (find != results_.end())
+            {
+                if (find->second.checked)
+                    continue;
+
+                find->second.checked = true;
+
+                if (still_matches(find->second, pattern))
+                    continue;
+
+                find->second.results.clear();
+            }
+            else
+            {
+                // Claim the key now, so duplicates and colliding patterns are handled like in scan_all
+                pattern_results results;
+                results.pattern = pack_pattern(pattern);
+                results.checked = true;
+
+                find = results_.emplace(hash, std::move(results)).first;
+            }
+
+            pending.push_back(pattern);
+            entries.push_back(&find->second);
+        }
+
+        if (pending.empty())
+            return;
+
+        const multi_scanner scanner(pending);
+
+        std::size_t overlap = 0;
+
+        for (const pattern& pattern : pending)
+            overlap = (std::max)(overlap, pattern.size());
+
+        overlap = overlap ? (overlap - 1) : 0;
+
+        const std::vector<multi_result> results = internal::scan_in_chunks<multi_result>(region_, resolve_chunk_size,
+            overlap, thread_count, [&scanner](region chunk, pointer limit, std::vector<multi_result>& chunk_results) {
+                scanner(chunk, [&chunk_results, limit](std::size_t index, pointer result) {
+                    if (result < limit)
+                        chunk_results.push_back({index, result});
+
+                    return false;
+                });
+            });
+
+        // Each pattern has a single anchor, so its results are already in order
+        for (const multi_result& result : results)
+            entries[result.index]->results.push_back(result.address);
+    }
+
     namespace stream
     {
         template <typename T>
@@ -166,13 +297,19 @@ namespace mem
     inline void pattern_cache::save(std::ostream& output) const
     {
         stream::write<std::uint32_t>(output, 0x50415443); // PATC
+        stream::write<std::uint32_t>(output, 2);
         stream::write<std::uint32_t>(output, sizeof(std::size_t));
         stream::write<std::size_t>(output, region_.size);
         stream::write<std::size_t>(output, results_.size());
 
         for (const auto& pattern : results_)
         {
-            stream::write<std::uint32_t>(output, pattern.first);
+            stream::write<std::uint64_t>(output, pattern.first);
+            stream::write<std::size_t>(output, pattern.second.pattern.size() / 2);
+
+            output.write(reinterpret_cast<const char*>(pattern.second.pattern.data()),
+                static_cast<std::streamsize>(pattern.second.pattern.size()));
+
             stream::write<std::size_t>(output, pattern.second.results.size());
 
             for (const auto& result : pattern.second.results)
@@ -186,7 +323,10 @@ namespace mem
     {
         try
         {
-            if (stream::read<std::uint32_t>(input) == 0x50415443)
+            if (stream::read<std::uint32_t>(input) != 0x50415443)
+                return false;
+
+            if (stream::read<std::uint32_t>(input) != 2)
                 return false;
 
             if (stream::read<std::uint32_t>(input) != sizeof(std::size_t))
@@ -197,25 +337,47 @@ namespace mem
 
             const std::size_t pattern_count = stream::read<std::size_t>(input);
 
-            results_.clear();
+            if (!input)
+                return false;
+
+            std::unordered_map<std::uint64_t, pattern_results> loaded;
 
             for (std::size_t i = 0; i < pattern_count; ++i)
             {
-                const std::uint32_t hash = stream::read<std::uint32_t>(input);
-                const std::size_t result_count = stream::read<std::size_t>(input);
+                const std::uint64_t hash = stream::read<std::uint64_t>(input);
+                const std::size_t length = stream::read<std::size_t>(input);
+
+                if (!input)
+                    return false;
 
                 pattern_results results;
                 results.checked = false;
-                results.results.reserve(result_count);
+                results.pattern.resize(length * 2);
+
+                input.read(reinterpret_cast<char*>(results.pattern.data()),
+                    static_cast<std::streamsize>(results.pattern.size()));
+
+                const std::size_t result_count = stream::read<std::size_t>(input);
+
+                if (!input)
+                    return false;
 
                 for (std::size_t j = 0; j < result_count; ++j)
                 {
-                    results.results.push_back(region_.start + stream::read<std::size_t>(input));
+                    const std::size_t offset = stream::read<std::size_t>(input);
+
+                    // Cached results are matched against the region before use, so the whole pattern must fit
+                    if (!input || (length > region_.size) || (offset > (region_.size - length)))
+                        return false;
+
+                    results.results.push_back(region_.start + offset);
                 }
 
-                results_.emplace(hash, std::move(results));
+                loaded.emplace(hash, std::move(results));
             }
 
+            results_ = std::move(loaded);
+
             return true;
         }
         catch (...)
@@ -0,0 +1,229 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_SIG_MAKER_BRICK_H
+#define MEM_SIG_MAKER_BRICK_H
+
+#include "mem.h"
+#include "pattern.h"
+#include "x86_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mem
+{
+    // Positions of every 4 byte sequence in a region, bucketed by hash
+    class qgram_index
+    {
+    private:
+        region range_ {};
+        unsigned bits_ {0};
+
+        std::vector<std::uint32_t> offsets_ {};
+        std::vector<std::uint32_t> positions_ {};
+
+        static std::uint32_t load(const byte* data) noexcept;
+
+    public:
+        static constexpr const std::size_t q = 4;
+
+        qgram_index() = default;
+        explicit qgram_index(region range);
+
+        std::size_t bucket(const byte* data, const std::uint32_t*& begin) const noexcept;
+
+        region range() const noexcept;
+    };
+
+    // Generates the shortest pattern which matches a single address in a region
+    class sig_maker
+    {
+    private:
+        qgram_index index_ {};
+
+        void make_masks(const byte* code, std::size_t size, byte* masks) const noexcept;
+
+    public:
+        sig_maker() = default;
+        explicit sig_maker(region range);
+
+        // Returns an empty pattern if no unique pattern of at most max_size bytes starts at the address
+        pattern make(pointer address, std::size_t max_size = 128) const;
+    };
+
+    MEM_STRONG_INLINE std::uint32_t qgram_index::load(const byte* data) noexcept
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    constexpr const std::size_t qgram_index::q;
+
+    inline qgram_index::qgram_index(region range)
+        : range_(range)
+    {
+        if (range_.size > UINT32_MAX)
+            throw std::length_error("Region too large");
+
+        const std::size_t count = (range_.size >= q) ? (range_.size - q + 1) : 0;
+
+        for (bits_ = 8; (bits_ < 24) && ((std::size_t(1) << bits_) < (count >> 2)); ++bits_)
+            ;
+
+        offsets_.assign((std::size_t(1) << bits_) + 1, 0);
+        positions_.resize(count);
+
+        const byte* const data = range_.start.as<const byte*>();
+        const unsigned shift = 32 - bits_;
+
+        for (std::size_t i = 0; i < count; ++i)
+            ++offsets_[((load(data + i) * 0x9E3779B1u) >> shift) + 1];
+
+        for (std::size_t i = 1; i < offsets_.size(); ++i)
+            offsets_[i] += offsets_[i - 1];
+
+        std::vector<std::uint32_t> heads(offsets_.begin(), offsets_.end() - 1);
+
+        for (std::size_t i = 0; i < count; ++i)
+            positions_[heads[(load(data + i) * 0x9E3779B1u) >> shift]++] = static_cast<std::uint32_t>(i);
+    }
+
+    MEM_STRONG_INLINE std::size_t qgram_index::bucket(const byte* data, const std::uint32_t*& begin) const noexcept
+    {
+        const std::size_t hash = (load(data) * 0x9E3779B1u) >> (32 - bits_);
+
+        begin = positions_.data() + offsets_[hash];
+
+        return offsets_[hash + 1] - offsets_[hash];
+    }
+
+    MEM_STRONG_INLINE region qgram_index::range() const noexcept
+    {
+        return range_;
+    }
+
+    inline sig_maker::sig_maker(region range)
+        : index_(range)
+    {}
+
+    inline void sig_maker::make_masks(const byte* code, std::size_t size, byte* masks) const noexcept
+    {
+        std::memset(masks, 0xFF, size);
+
+        x86_instruction insn;
+
+        // Anything after an undecodable instruction is left solid
+        for (std::size_t pos = 0; (pos < size) && decode_x86_64(code + pos, size - pos, insn); pos += insn.length)
+        {
+            if (insn.rip_relative)
+                std::memset(masks + pos + insn.disp_offset, 0x00, insn.disp_size);
+
+            std::memset(masks + pos + insn.imm_offset, 0x00, insn.imm_size);
+        }
+    }
+
+    inline pattern sig_maker::make(pointer address, std::size_t max_size) const
+    {
+        const region range = index_.range();
+
+        if (!range.contains(address))
+            return pattern();
+
+        const byte* const data = range.start.as<const byte*>();
+        const std::size_t target = static_cast<std::size_t>(address - range.start);
+
+        const std::size_t available = range.size - target;
+
+        if (max_size > available)
+            max_size = available;
+
+        const byte* const bytes = data + target;
+
+        // Decode past the end, so the last instruction is not truncated
+        std::vector<byte> masks(std::min(max_size + 15, available));
+        make_masks(bytes, masks.size(), masks.data());
+
+        // Starting offsets which match every byte so far, once a solid q-gram has narrowed them down
+        std::vector<std::size_t> candidates;
+        bool narrowed = false;
+
+        std::size_t solid_run = 0;
+
+        for (std::size_t length = 1; length <= max_size; ++length)
+        {
+            const std::size_t last = length - 1;
+            const byte mask = masks[last];
+
+            solid_run = (mask == 0xFF) ? (solid_run + 1) : 0;
+
+            const std::uint32_t* bucket = nullptr;
+            const std::size_t bucket_size =
+                (solid_run >= qgram_index::q) ? index_.bucket(bytes + length - qgram_index::q, bucket) : 0;
+
+            if (bucket && (!narrowed || (bucket_size < candidates.size())))
+            {
+                candidates.clear();
+
+                const std::size_t gram_offset = length - qgram_index::q;
+
+                for (std::size_t i = 0; i < bucket_size; ++i)
+                {
+                    if (bucket[i] < gram_offset)
+                        continue;
+
+                    const std::size_t start = bucket[i] - gram_offset;
+
+                    if (start + length > range.size)
+                        continue;
+
+                    std::size_t j = 0;
+
+                    while ((j < length) && !((data[start + j] ^ bytes[j]) & masks[j]))
+                        ++j;
+
+                    if (j == length)
+                        candidates.push_back(start);
+                }
+
+                narrowed = true;
+            }
+            else if (narrowed)
+            {
+                const byte value = static_cast<byte>(bytes[last] & mask);
+
+                candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                     [&](std::size_t start) {
+                                         return (start + length > range.size) ||
+                                             ((data[start + last] & mask) != value);
+                                     }),
+                    candidates.end());
+            }
+
+            if (narrowed && (candidates.size() == 1) && (mask == 0xFF))
+                return pattern(bytes, masks.data(), length);
+        }
+
+        return pattern();
+    }
+} // namespace mem
+
+#endif // MEM_SIG_MAKER_BRICK_H
@@ -0,0 +1,437 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_SIGNATURE_DB_BRICK_H
+#define MEM_SIGNATURE_DB_BRICK_H
+
+#include "auto_scanner.h"
+#include "pattern.h"
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mem
+{
+    // A compiled set of named patterns, along with the state of their scanners.
+    // It is used in place (such as from a mapped file), without any parsing or per-pattern allocations.
+    class signature_db
+    {
+    private:
+        struct header
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t count;
+            std::uint32_t size;
+        };
+
+        static constexpr const std::uint32_t flag_needs_masks {0x1};
+        static constexpr const std::uint32_t flag_boyer_moore {0x2};
+        static constexpr const std::uint32_t flag_wide_skips {0x4};
+
+        // Offsets are from the start of the database, with 0 marking a missing table. The simd engine stores its
+        // anchors in skip_pos and pair_pos, while Boyer-Moore stores its forward and reverse probes.
+        struct entry
+        {
+            std::uint32_t name_offset;
+            std::uint32_t name_size;
+            std::uint32_t data_offset;
+            std::uint32_t size;
+            std::uint32_t trimmed_size;
+            std::uint32_t flags;
+            std::uint32_t skip_pos;
+            std::uint32_t pair_pos;
+            std::uint32_t bc_offset;
+            std::uint32_t rbc_offset;
+            std::uint32_t gs_offset;
+            std::uint32_t capture_offset;
+            std::uint32_t capture_count;
+            std::uint32_t reserved;
+        };
+
+        const byte* data_ {nullptr};
+        const entry* entries_ {nullptr};
+        std::size_t size_ {0};
+
+        static bool check_entry(const byte* data, const entry& entry, std::size_t length) noexcept;
+        static bool check_skips(const byte* table, bool wide, std::size_t max_skip) noexcept;
+        static bool check_suffixes(const byte* table, std::size_t trimmed_size) noexcept;
+
+        static std::uint32_t append(std::vector<byte>& output, const void* data, std::size_t size);
+        static void align(std::vector<byte>& output, std::size_t alignment);
+
+        static std::uint32_t to_pos(std::size_t pos) noexcept;
+        static std::size_t from_pos(std::uint32_t pos) noexcept;
+
+    public:
+        static constexpr const std::uint32_t magic {0x44474953}; // SIGD
+        static constexpr const std::uint32_t version {2};
+
+        signature_db() = default;
+
+        // The data must be aligned to 4 bytes, and outlive the database and any scanners created from it.
+        // Every offset and skip is checked, so corrupt data can cause missed matches but never a bad read or a hang.
+        bool load(const void* data, std::size_t length) noexcept;
+
+        static void save(
+            std::ostream& output, const std::vector<std::string>& names, const std::vector<pattern>& patterns);
+
+        std::size_t size() const noexcept;
+
+        const char* get_name(std::size_t index) const noexcept;
+        pattern_view get_pattern(std::size_t index) const noexcept;
+        auto_scanner get_scanner(std::size_t index) const;
+
+        // Returns the index of the first pattern with this name, or SIZE_MAX
+        std::size_t find(const char* name) const noexcept;
+    };
+
+    constexpr const std::uint32_t signature_db::flag_needs_masks;
+    constexpr const std::uint32_t signature_db::flag_boyer_moore;
+    constexpr const std::uint32_t signature_db::flag_wide_skips;
+    constexpr const std::uint32_t signature_db::magic;
+    constexpr const std::uint32_t signature_db::version;
+
+    inline bool signature_db::load(const void* data, std::size_t length) noexcept
+    {
+        data_ = nullptr;
+        entries_ = nullptr;
+        size_ = 0;
+
+        if ((reinterpret_cast<std::uintptr_t>(data) % alignof(entry)) || (length < sizeof(header)))
+            return false;
+
+        const header& head = *static_cast<const header*>(data);
+
+        if ((head.magic != magic) || (head.version != version) || (head.size != length))
+            return false;
+
+        if (head.count > (length - sizeof(header)) / sizeof(entry))
+            return false;
+
+        const entry* const entries = reinterpret_cast<const entry*>(static_cast<const byte*>(data) + sizeof(header));
+
+        for (std::size_t i = 0; i < head.count; ++i)
+        {
+            if (!check_entry(static_cast<const byte*>(data), entries[i], length))
+                return false;
+
+            const pattern_capture* const captures = reinterpret_cast<const pattern_capture*>(
+                static_cast<const byte*>(data) + entries[i].capture_offset);
+
+            for (std::size_t j = 0; j < entries[i].capture_count; ++j)
+            {
+                if (!captures[j].is_valid(entries[i].size))
+                    return false;
+            }
+
+            const byte* const name = static_cast<const byte*>(data) + entries[i].name_offset;
+
+            if (name[entries[i].name_size] != 0x00)
+                return false;
+        }
+
+        data_ = static_cast<const byte*>(data);
+        entries_ = entries;
+        size_ = head.count;
+
+        return true;
+    }
+
+    inline bool signature_db::check_entry(const byte* data, const entry& entry, std::size_t length) noexcept
+    {
+        const std::size_t size = entry.size;
+        const bool wide = (entry.flags & flag_wide_skips) != 0;
+        const std::size_t table_size = wide ? 512 : 256;
+
+        if ((entry.trimmed_size > size) || (entry.name_offset == 0))
+            return false;
+
+        if ((entry.name_size >= length) || (entry.name_offset >= length - entry.name_size))
+            return false;
+
+        if (size && ((entry.data_offset == 0) || (entry.data_offset > length) ||
+                        ((length - entry.data_offset) < (size + pattern_view::padding_size) * 2)))
+            return false;
+
+        if ((from_pos(entry.skip_pos) != SIZE_MAX) && (entry.skip_pos >= size))
+            return false;
+
+        if ((from_pos(entry.pair_pos) != SIZE_MAX) && (entry.pair_pos >= size))
+            return false;
+
+        if (entry.bc_offset && ((entry.bc_offset > length) || ((length - entry.bc_offset) < table_size)))
+            return false;
+
+        if (entry.rbc_offset && ((entry.rbc_offset > length) || ((length - entry.rbc_offset) < table_size)))
+            return false;
+
+        if (entry.gs_offset && ((entry.gs_offset % alignof(std::uint16_t)) || (entry.gs_offset > length) ||
+                                   ((length - entry.gs_offset) < entry.trimmed_size * sizeof(std::uint16_t))))
+            return false;
+
+        if (entry.capture_count &&
+            ((entry.capture_offset % alignof(pattern_capture)) || (entry.capture_offset > length) ||
+                ((length - entry.capture_offset) / sizeof(pattern_capture) < entry.capture_count)))
+            return false;
+
+        // The scanners trust their tables, so a skip which never advances would scan forever
+        if (entry.bc_offset &&
+            ((from_pos(entry.skip_pos) == SIZE_MAX) || !check_skips(data + entry.bc_offset, wide, entry.trimmed_size)))
+            return false;
+
+        if (entry.rbc_offset &&
+            ((from_pos(entry.pair_pos) == SIZE_MAX) || !check_skips(data + entry.rbc_offset, wide, entry.trimmed_size)))
+            return false;
+
+        if (entry.gs_offset && !check_suffixes(data + entry.gs_offset, entry.trimmed_size))
+            return false;
+
+        // The simd engine measures the distance from its first anchor to the second
+        if (!(entry.flags & flag_boyer_moore) && (from_pos(entry.pair_pos) != SIZE_MAX) &&
+            ((from_pos(entry.skip_pos) == SIZE_MAX) || (entry.pair_pos <= entry.skip_pos)))
+            return false;
+
+        return true;
+    }
+
+    inline bool signature_db::check_skips(const byte* table, bool wide, std::size_t max_skip) noexcept
+    {
+        for (std::size_t i = 0; i < 256; ++i)
+        {
+            std::size_t skip = table[i];
+
+            if (wide)
+            {
+                std::uint16_t value;
+                std::memcpy(&value, table + (i * sizeof(value)), sizeof(value));
+                skip = value;
+            }
+
+            if (skip > max_skip)
+                return false;
+        }
+
+        return true;
+    }
+
+    inline bool signature_db::check_suffixes(const byte* table, std::size_t trimmed_size) noexcept
+    {
+        const std::uint16_t* const suffixes = reinterpret_cast<const std::uint16_t*>(table);
+
+        // A mismatch at i must move the end of the window past the bytes already compared
+        for (std::size_t i = 0; i < trimmed_size; ++i)
+        {
+            if (suffixes[i] < trimmed_size - i)
+                return false;
+        }
+
+        return true;
+    }
+
+    inline std::uint32_t signature_db::append(std::vector<byte>& output, const void* data, std::size_t size)
+    {
+        const std::size_t offset = output.size();
+
+        if ((offset + size) > UINT32_MAX)
+            throw std::length_error("Signature database too large");
+
+        output.resize(offset + size);
+
+        if (data)
+            std::memcpy(output.data() + offset, data, size);
+
+        return static_cast<std::uint32_t>(offset);
+    }
+
+    inline void signature_db::align(std::vector<byte>& output, std::size_t alignment)
+    {
+        if (output.size() % alignment)
+            append(output, nullptr, alignment - (output.size() % alignment));
+    }
+
+    MEM_STRONG_INLINE std::uint32_t signature_db::to_pos(std::size_t pos) noexcept
+    {
+        return (pos != SIZE_MAX) ? static_cast<std::uint32_t>(pos) : UINT32_MAX;
+    }
+
+    MEM_STRONG_INLINE std::size_t signature_db::from_pos(std::uint32_t pos) noexcept
+    {
+        return (pos != UINT32_MAX) ? pos : SIZE_MAX;
+    }
+
+    inline void signature_db::save(
+        std::ostream& output, const std::vector<std::string>& names, const std::vector<pattern>& patterns)
+    {
+        const std::size_t count = patterns.size();
+
+        std::vector<entry> entries(count);
+        std::vector<byte> data(sizeof(header) + (sizeof(entry) * count));
+
+        const byte* const frequencies = simd_scanner::default_frequencies();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const pattern& pattern = patterns[i];
+            const std::string name = (i < names.size()) ? names[i] : std::string();
+
+            entry& current = entries[i];
+
+            current = entry();
+            current.name_offset = append(data, name.c_str(), name.size() + 1);
+            current.name_size = static_cast<std::uint32_t>(name.size());
+            current.size = static_cast<std::uint32_t>(pattern.size());
+            current.trimmed_size = static_cast<std::uint32_t>(pattern.trimmed_size());
+            current.flags = pattern.needs_masks() ? flag_needs_masks : 0;
+            current.skip_pos = UINT32_MAX;
+            current.pair_pos = UINT32_MAX;
+
+            if (pattern)
+            {
+                const std::size_t padded_size = pattern.size() + pattern_view::padding_size;
+
+                current.data_offset = append(data, nullptr, padded_size * 2);
+
+                std::memcpy(data.data() + current.data_offset, pattern.bytes(), pattern.size());
+                std::memcpy(data.data() + current.data_offset + padded_size, pattern.masks(), pattern.size());
+            }
+
+            if (!pattern.captures().empty())
+            {
+                align(data, alignof(pattern_capture));
+
+                current.capture_offset = append(
+                    data, pattern.captures().data(), pattern.captures().size() * sizeof(pattern_capture));
+                current.capture_count = static_cast<std::uint32_t>(pattern.captures().size());
+            }
+
+            if (auto_scanner::select_engine(pattern, frequencies) == scan_engine::simd)
+            {
+                simd_scanner scanner(pattern, frequencies);
+
+                current.skip_pos = to_pos(scanner.skip_pos());
+                current.pair_pos = to_pos(scanner.pair_pos());
+
+                continue;
+            }
+
+            boyer_moore_scanner scanner(pattern);
+
+            const boyer_moore_scanner::tables tables = scanner.get_tables();
+
+            const std::size_t table_size = tables.wide ? 512 : 256;
+
+            current.flags |= flag_boyer_moore | (tables.wide ? flag_wide_skips : 0);
+            current.skip_pos = to_pos(tables.skip_pos);
+            current.pair_pos = to_pos(tables.rskip_pos);
+
+            if (tables.bc_skips)
+                current.bc_offset = append(data, tables.bc_skips, table_size);
+
+            if (tables.rbc_skips)
+                current.rbc_offset = append(data, tables.rbc_skips, table_size);
+
+            if (tables.gs_skips)
+            {
+                align(data, alignof(std::uint16_t));
+
+                current.gs_offset = append(data, tables.gs_skips, pattern.trimmed_size() * sizeof(std::uint16_t));
+            }
+        }
+
+        header head;
+        head.magic = magic;
+        head.version = version;
+        head.count = static_cast<std::uint32_t>(count);
+        head.size = static_cast<std::uint32_t>(data.size());
+
+        std::memcpy(data.data(), &head, sizeof(head));
+
+        if (count)
+            std::memcpy(data.data() + sizeof(header), entries.data(), sizeof(entry) * count);
+
+        output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    MEM_STRONG_INLINE std::size_t signature_db::size() const noexcept
+    {
+        return size_;
+    }
+
+    MEM_STRONG_INLINE const char* signature_db::get_name(std::size_t index) const noexcept
+    {
+        return reinterpret_cast<const char*>(data_ + entries_[index].name_offset);
+    }
+
+    MEM_STRONG_INLINE pattern_view signature_db::get_pattern(std::size_t index) const noexcept
+    {
+        const entry& current = entries_[index];
+
+        if (!current.size)
+            return pattern_view();
+
+        const byte* const bytes = data_ + current.data_offset;
+        const byte* const masks = bytes + current.size + pattern_view::padding_size;
+
+        const pattern_capture* const captures =
+            current.capture_count ? reinterpret_cast<const pattern_capture*>(data_ + current.capture_offset) : nullptr;
+
+        return pattern_view(bytes, masks, current.size, current.trimmed_size, (current.flags & flag_needs_masks) != 0,
+            captures, current.capture_count);
+    }
+
+    inline auto_scanner signature_db::get_scanner(std::size_t index) const
+    {
+        const entry& current = entries_[index];
+
+        const pattern_view pattern = get_pattern(index);
+
+        if (!(current.flags & flag_boyer_moore))
+            return simd_scanner(pattern, from_pos(current.skip_pos), from_pos(current.pair_pos));
+
+        boyer_moore_scanner::tables tables;
+
+        tables.bc_skips = current.bc_offset ? (data_ + current.bc_offset) : nullptr;
+        tables.rbc_skips = current.rbc_offset ? (data_ + current.rbc_offset) : nullptr;
+        tables.gs_skips =
+            current.gs_offset ? reinterpret_cast<const std::uint16_t*>(data_ + current.gs_offset) : nullptr;
+        tables.skip_pos = from_pos(current.skip_pos);
+        tables.rskip_pos = from_pos(current.pair_pos);
+        tables.wide = (current.flags & flag_wide_skips) != 0;
+
+        return boyer_moore_scanner(pattern, tables);
+    }
+
+    inline std::size_t signature_db::find(const char* name) const noexcept
+    {
+        const std::size_t length = std::strlen(name);
+
+        for (std::size_t i = 0; i < size_; ++i)
+        {
+            if ((entries_[i].name_size == length) && !std::memcmp(data_ + entries_[i].name_offset, name, length))
+                return i;
+        }
+
+        return SIZE_MAX;
+    }
+} // namespace mem
+
+#endif // MEM_SIGNATURE_DB_BRICK_H
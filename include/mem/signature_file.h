@@ -0,0 +1,358 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_SIGNATURE_FILE_BRICK_H
+#define MEM_SIGNATURE_FILE_BRICK_H
+
+#include "pattern.h"
+#include "simd_scanner.h"
+
+#include <string>
+#include <vector>
+
+namespace mem
+{
+    struct signature_error
+    {
+        std::size_t line;
+        std::size_t column;
+        const char* message;
+    };
+
+    // Parses a buffer of "name = pattern" lines, using the same pattern syntax as pattern(const char*).
+    // Blank lines and lines starting with '#' are ignored. Lines with errors are skipped and reported in errors().
+    class signature_file
+    {
+    private:
+        std::vector<std::string> names_;
+        std::vector<pattern> patterns_;
+        std::vector<signature_error> errors_;
+
+        std::vector<byte> bytes_;
+        std::vector<byte> masks_;
+        std::vector<pattern_capture> captures_;
+
+        static bool fail(
+            signature_error& error, const char* line, const char* position, const char* message) noexcept;
+
+        bool parse_line(const char* start, const char* end, char wildcard, signature_error& error);
+        bool parse_pattern(
+            const char* line, const char* current, const char* end, char wildcard, signature_error& error);
+
+    public:
+        signature_file() = default;
+
+        bool load(const char* data, std::size_t length,
+            pattern::wildcard_t wildcard = static_cast<pattern::wildcard_t>('?'));
+
+        std::size_t size() const noexcept;
+
+        const std::vector<std::string>& names() const noexcept;
+        const std::vector<pattern>& patterns() const noexcept;
+        const std::vector<signature_error>& errors() const noexcept;
+    };
+
+    namespace internal
+    {
+        // Hex digits map to their value, separators to 0x10 and everything else to 0xFF
+        const byte* hex_table() noexcept;
+    } // namespace internal
+
+    MEM_STRONG_INLINE const byte* internal::hex_table() noexcept
+    {
+        // clang-format off
+        static constexpr const byte table[256]
+        {
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x10,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0x10,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+            0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+        };
+        // clang-format on
+
+        return table;
+    }
+
+    inline bool signature_file::load(const char* data, std::size_t length, pattern::wildcard_t wildcard)
+    {
+        names_.clear();
+        patterns_.clear();
+        errors_.clear();
+
+        const byte* const start = reinterpret_cast<const byte*>(data);
+        const byte* const end = start + length;
+
+        // Count the lines up front, so the output is only allocated once
+        std::size_t line_count = 1;
+
+        for (const byte* current = start; current != end;)
+        {
+            current = find_byte(current, '\n', static_cast<std::size_t>(end - current));
+
+            if (current != end)
+            {
+                ++current;
+                ++line_count;
+            }
+        }
+
+        names_.reserve(line_count);
+        patterns_.reserve(line_count);
+
+        std::size_t line = 1;
+
+        for (const byte* current = start; current != end; ++line)
+        {
+            // find_byte returns end when there is no newline left
+            const byte* const next = find_byte(current, '\n', static_cast<std::size_t>(end - current));
+
+            const char* line_start = reinterpret_cast<const char*>(current);
+            const char* line_end = reinterpret_cast<const char*>(next);
+
+            if ((line_end != line_start) && (line_end[-1] == '\r'))
+                --line_end;
+
+            signature_error error {line, 0, nullptr};
+
+            if (!parse_line(line_start, line_end, static_cast<char>(wildcard), error))
+                errors_.push_back(error);
+
+            current = (next != end) ? (next + 1) : end;
+        }
+
+        return errors_.empty();
+    }
+
+    MEM_STRONG_INLINE bool signature_file::fail(
+        signature_error& error, const char* line, const char* position, const char* message) noexcept
+    {
+        error.column = static_cast<std::size_t>(position - line) + 1;
+        error.message = message;
+
+        return false;
+    }
+
+    inline bool signature_file::parse_line(const char* start, const char* end, char wildcard, signature_error& error)
+    {
+        const byte* const table = internal::hex_table();
+
+        const char* current = start;
+
+        while ((current != end) && (table[static_cast<byte>(*current)] == 0x10))
+            ++current;
+
+        if ((current == end) || (*current == '#'))
+            return true;
+
+        const char* const name_start = current;
+        const char* name_end =
+            static_cast<const char*>(std::memchr(current, '=', static_cast<std::size_t>(end - current)));
+
+        if (!name_end)
+            return fail(error, start, end, "Expected '='");
+
+        current = name_end + 1;
+
+        while ((name_end != name_start) && (table[static_cast<byte>(name_end[-1])] == 0x10))
+            --name_end;
+
+        if (name_end == name_start)
+            return fail(error, start, name_start, "Expected name");
+
+        if (!parse_pattern(start, current, end, wildcard, error))
+            return false;
+
+        names_.emplace_back(name_start, name_end);
+
+        return true;
+    }
+
+    inline bool signature_file::parse_pattern(
+        const char* line, const char* current, const char* end, char wildcard, signature_error& error)
+    {
+        const byte* const table = internal::hex_table();
+
+        // Without any repeats, each character produces at most one byte
+        if (bytes_.size() < static_cast<std::size_t>(end - current))
+        {
+            bytes_.resize(static_cast<std::size_t>(end - current));
+            masks_.resize(static_cast<std::size_t>(end - current));
+        }
+
+        std::size_t size = 0;
+
+        captures_.clear();
+
+        while (current != end)
+        {
+            unsigned digit = table[static_cast<byte>(*current)];
+
+            if (digit == 0x10)
+            {
+                ++current;
+
+                continue;
+            }
+
+            // Captures are rare, so they use the slower shared parser
+            if (*current == '[')
+            {
+                char_queue input(current, static_cast<std::size_t>(end - current));
+
+                pattern_capture capture;
+
+                if (!internal::parse_capture(input, size, capture))
+                    return fail(error, line, current + input.pos(), "Invalid capture");
+
+                std::memset(bytes_.data() + size, 0x00, capture.size);
+                std::memset(masks_.data() + size, 0x00, capture.size);
+
+                captures_.push_back(capture);
+
+                size += capture.size;
+                current += input.pos();
+
+                continue;
+            }
+
+            unsigned value = 0x00;
+            unsigned mask = 0x00;
+
+            std::size_t count = 1;
+
+            // clang-format off
+            if (digit < 0x10)              { ++current; value = digit; mask = 0xFF; }
+            else if (*current == wildcard) { ++current;                             }
+            else                           { return fail(error, line, current, "Invalid character"); }
+
+            if (current != end)
+            {
+                digit = table[static_cast<byte>(*current)];
+
+                if (digit < 0x10)              { ++current; value = (value << 4) | digit; mask = (mask << 4) | 0x0F; }
+                else if (*current == wildcard) { ++current; value = (value << 4);         mask = (mask << 4);        }
+            }
+            // clang-format on
+
+            if ((current != end) && (*current == '&'))
+            {
+                ++current;
+
+                if ((current == end) || ((digit = table[static_cast<byte>(*current)]) >= 0x10))
+                    return fail(error, line, current, "Expected mask");
+
+                ++current;
+
+                unsigned expl_mask = digit;
+
+                if ((current != end) && ((digit = table[static_cast<byte>(*current)]) < 0x10))
+                {
+                    ++current;
+
+                    expl_mask = (expl_mask << 4) | digit;
+                }
+
+                mask &= expl_mask;
+            }
+
+            if ((current != end) && (*current == '#'))
+            {
+                ++current;
+
+                count = 0;
+
+                for (int temp; (current != end) && ((temp = dctoi(*current)) != -1); ++current)
+                {
+                    if (count > (internal::max_pattern_size - static_cast<std::size_t>(temp)) / 10)
+                        return fail(error, line, current, "Repeat count too large");
+
+                    count = (count * 10) + static_cast<std::size_t>(temp);
+                }
+
+                if (!count)
+                    return fail(error, line, current, "Expected repeat count");
+
+                if (count > internal::max_pattern_size - size)
+                    return fail(error, line, current, "Repeat count too large");
+            }
+
+            if (count == 1)
+            {
+                bytes_[size] = static_cast<byte>(value & mask);
+                masks_[size] = static_cast<byte>(mask);
+
+                ++size;
+
+                continue;
+            }
+
+            if (bytes_.size() - size < count)
+            {
+                bytes_.resize(size + count + static_cast<std::size_t>(end - current));
+                masks_.resize(size + count + static_cast<std::size_t>(end - current));
+            }
+
+            std::memset(bytes_.data() + size, static_cast<byte>(value & mask), count);
+            std::memset(masks_.data() + size, static_cast<byte>(mask), count);
+
+            size += count;
+        }
+
+        if (!size)
+            return fail(error, line, end, "Expected pattern");
+
+        patterns_.emplace_back(bytes_.data(), masks_.data(), size, captures_.data(), captures_.size());
+
+        return true;
+    }
+
+    MEM_STRONG_INLINE std::size_t signature_file::size() const noexcept
+    {
+        return patterns_.size();
+    }
+
+    MEM_STRONG_INLINE const std::vector<std::string>& signature_file::names() const noexcept
+    {
+        return names_;
+    }
+
+    MEM_STRONG_INLINE const std::vector<pattern>& signature_file::patterns() const noexcept
+    {
+        return patterns_;
+    }
+
+    MEM_STRONG_INLINE const std::vector<signature_error>& signature_file::errors() const noexcept
+    {
+        return errors_;
+    }
+} // namespace mem
+
+#endif // MEM_SIGNATURE_FILE_BRICK_H
@@ -0,0 +1,374 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_SIGNATURE_SET_BRICK_H
+#define MEM_SIGNATURE_SET_BRICK_H
+
+#include "multi_scanner.h"
+#include "pattern.h"
+
+#include <algorithm>
+
+namespace mem
+{
+    // Patterns merged into a trie on their masked bytes, so shared prefixes are only checked once per candidate.
+    // Chains without branches are compressed into runs, which are compared like a pattern.
+    class signature_set
+    {
+    private:
+        struct node
+        {
+            // Bytes which must match after the edge leading to this node
+            std::uint32_t run_begin;
+            std::uint32_t run_size;
+
+            // Edges on fully masked bytes are sorted by value, followed by the remaining masked edges
+            std::uint32_t edges_begin;
+            std::uint32_t solid_end;
+            std::uint32_t edges_end;
+
+            // Patterns whose last byte leads to this node
+            std::uint32_t terminals_begin;
+            std::uint32_t terminals_end;
+        };
+
+        struct edge
+        {
+            byte value;
+            byte mask;
+            std::uint32_t child;
+        };
+
+        std::vector<const pattern*> patterns_ {};
+
+        std::vector<node> nodes_ {};
+        std::vector<edge> edges_ {};
+        std::vector<std::uint32_t> terminals_ {};
+
+        // Zero padded past the last run, so SIMD compares can load whole vectors
+        std::vector<byte> run_bytes_ {};
+        std::vector<byte> run_masks_ {};
+
+        // One bit for every pair of bytes which could start a match
+        std::vector<std::uint64_t> filter_ {};
+
+        // Patterns of a single byte, which can also match at the end of a range
+        bool has_short_ {false};
+
+        void build(std::uint32_t index, const std::uint32_t* begin, const std::uint32_t* end, std::size_t depth);
+
+        void set_filter(const edge& entry);
+        void set_filter(std::uint32_t low, byte value, byte mask);
+
+        template <typename Func>
+        bool walk(std::uint32_t index, const byte* data, std::size_t depth, std::size_t size, Func& func) const;
+
+    public:
+        signature_set() = default;
+
+        signature_set(const std::vector<pattern>& patterns);
+
+        template <typename Func>
+        void operator()(region range, Func func) const;
+
+        std::vector<multi_result> scan_all(region range) const;
+
+        std::size_t node_count() const noexcept;
+    };
+
+    inline signature_set::signature_set(const std::vector<pattern>& patterns)
+        : filter_(0x10000 / 64)
+    {
+        patterns_.reserve(patterns.size());
+
+        for (const pattern& pattern : patterns)
+            patterns_.push_back(&pattern);
+
+        std::vector<std::uint32_t> order;
+
+        for (std::uint32_t i = 0; i < patterns_.size(); ++i)
+        {
+            if (patterns_[i]->trimmed_size())
+                order.push_back(i);
+        }
+
+        // Sort on (mask, value) with fully masked bytes first, so patterns sharing a prefix are adjacent
+        std::stable_sort(order.begin(), order.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+            const pattern& left = *patterns_[lhs];
+            const pattern& right = *patterns_[rhs];
+
+            const std::size_t size = std::min(left.trimmed_size(), right.trimmed_size());
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                const std::uint32_t left_key =
+                    (static_cast<std::uint32_t>(0xFF - left.masks()[i]) << 8) | left.bytes()[i];
+                const std::uint32_t right_key =
+                    (static_cast<std::uint32_t>(0xFF - right.masks()[i]) << 8) | right.bytes()[i];
+
+                if (left_key != right_key)
+                    return left_key < right_key;
+            }
+
+            return left.trimmed_size() < right.trimmed_size();
+        });
+
+        nodes_.push_back({});
+
+        build(0, order.data(), order.data() + order.size(), 0);
+
+        run_bytes_.resize(run_bytes_.size() + 32, 0x00);
+        run_masks_.resize(run_masks_.size() + 32, 0x00);
+
+        const node& root = nodes_[0];
+
+        for (std::uint32_t i = root.edges_begin; i < root.edges_end; ++i)
+            set_filter(edges_[i]);
+    }
+
+    inline void signature_set::build(
+        std::uint32_t index, const std::uint32_t* begin, const std::uint32_t* end, std::size_t depth)
+    {
+        const std::uint32_t run_begin = static_cast<std::uint32_t>(run_bytes_.size());
+
+        // Patterns are sorted, so they all share the next byte if the first and last do. The root has no run, so the
+        // filter only needs to look at its edges.
+        while (index && (begin != end) && (patterns_[*begin]->trimmed_size() > depth) &&
+            (patterns_[*begin]->bytes()[depth] == patterns_[end[-1]]->bytes()[depth]) &&
+            (patterns_[*begin]->masks()[depth] == patterns_[end[-1]]->masks()[depth]))
+        {
+            run_bytes_.push_back(patterns_[*begin]->bytes()[depth]);
+            run_masks_.push_back(patterns_[*begin]->masks()[depth]);
+
+            ++depth;
+        }
+
+        const std::uint32_t run_size = static_cast<std::uint32_t>(run_bytes_.size()) - run_begin;
+
+        // Shorter patterns sort first, so the ones ending here are at the front
+        const std::uint32_t terminals_begin = static_cast<std::uint32_t>(terminals_.size());
+
+        while ((begin != end) && (patterns_[*begin]->trimmed_size() == depth))
+            terminals_.push_back(*begin++);
+
+        const std::uint32_t terminals_end = static_cast<std::uint32_t>(terminals_.size());
+
+        std::vector<const std::uint32_t*> groups;
+
+        for (const std::uint32_t* i = begin; i != end; ++i)
+        {
+            if ((i == begin) || (patterns_[*i]->bytes()[depth] != patterns_[i[-1]]->bytes()[depth]) ||
+                (patterns_[*i]->masks()[depth] != patterns_[i[-1]]->masks()[depth]))
+                groups.push_back(i);
+        }
+
+        groups.push_back(end);
+
+        // Reserve this node's edges before any children, so they stay contiguous
+        const std::uint32_t edges_begin = static_cast<std::uint32_t>(edges_.size());
+        const std::uint32_t edges_end = edges_begin + static_cast<std::uint32_t>(groups.size() - 1);
+
+        edges_.resize(edges_end);
+
+        std::uint32_t solid_end = edges_begin;
+
+        for (std::size_t i = 0; i + 1 < groups.size(); ++i)
+        {
+            const pattern& first = *patterns_[*groups[i]];
+
+            const std::uint32_t child = static_cast<std::uint32_t>(nodes_.size());
+
+            nodes_.push_back({});
+
+            edge& entry = edges_[edges_begin + i];
+
+            entry.value = first.bytes()[depth];
+            entry.mask = first.masks()[depth];
+            entry.child = child;
+
+            if (entry.mask == 0xFF)
+                ++solid_end;
+
+            build(child, groups[i], groups[i + 1], depth + 1);
+        }
+
+        node& current = nodes_[index];
+
+        current.run_begin = run_begin;
+        current.run_size = run_size;
+        current.edges_begin = edges_begin;
+        current.solid_end = solid_end;
+        current.edges_end = edges_end;
+        current.terminals_begin = terminals_begin;
+        current.terminals_end = terminals_end;
+    }
+
+    inline void signature_set::set_filter(const edge& entry)
+    {
+        const node& child = nodes_[entry.child];
+
+        const std::uint32_t first_bits = static_cast<byte>(~entry.mask);
+
+        // Visit every byte matching the masked value, by walking the subsets of the wildcard bits
+        for (std::uint32_t first = first_bits;; first = (first - 1) & first_bits)
+        {
+            const std::uint32_t low = entry.value | first;
+
+            if (child.run_size)
+            {
+                set_filter(low, run_bytes_[child.run_begin], run_masks_[child.run_begin]);
+            }
+            else if (child.terminals_begin != child.terminals_end)
+            {
+                has_short_ = true;
+
+                for (std::uint32_t high = 0; high < 256; ++high)
+                {
+                    const std::uint32_t key = low | (high << 8);
+
+                    filter_[key >> 6] |= std::uint64_t(1) << (key & 63);
+                }
+            }
+
+            if (!child.run_size)
+            {
+                for (std::uint32_t i = child.edges_begin; i < child.edges_end; ++i)
+                    set_filter(low, edges_[i].value, edges_[i].mask);
+            }
+
+            if (!first)
+                break;
+        }
+    }
+
+    inline void signature_set::set_filter(std::uint32_t low, byte value, byte mask)
+    {
+        const std::uint32_t bits = static_cast<byte>(~mask);
+
+        for (std::uint32_t high = bits;; high = (high - 1) & bits)
+        {
+            const std::uint32_t key = low | (static_cast<std::uint32_t>(value | high) << 8);
+
+            filter_[key >> 6] |= std::uint64_t(1) << (key & 63);
+
+            if (!high)
+                break;
+        }
+    }
+
+    template <typename Func>
+    inline bool signature_set::walk(
+        std::uint32_t index, const byte* data, std::size_t depth, std::size_t size, Func& func) const
+    {
+        const node& current = nodes_[index];
+
+        if (current.run_size)
+        {
+            if ((current.run_size > size - depth) ||
+                !internal::match_masked(data + depth, run_bytes_.data() + current.run_begin,
+                    run_masks_.data() + current.run_begin, current.run_size))
+                return false;
+
+            depth += current.run_size;
+        }
+
+        for (std::uint32_t i = current.terminals_begin; i < current.terminals_end; ++i)
+        {
+            const std::uint32_t pattern_index = terminals_[i];
+
+            if ((patterns_[pattern_index]->size() <= size) && func(static_cast<std::size_t>(pattern_index), pointer(data)))
+                return true;
+        }
+
+        if (depth == size)
+            return false;
+
+        const byte value = data[depth];
+
+        const edge* const edges = edges_.data();
+
+        // At most one fully masked edge can match
+        const edge* const solid = std::lower_bound(edges + current.edges_begin, edges + current.solid_end, value,
+            [](const edge& lhs, byte rhs) { return lhs.value < rhs; });
+
+        if ((solid != edges + current.solid_end) && (solid->value == value) &&
+            walk(solid->child, data, depth + 1, size, func))
+            return true;
+
+        for (std::uint32_t i = current.solid_end; i < current.edges_end; ++i)
+        {
+            const edge& entry = edges[i];
+
+            if (((value & entry.mask) == entry.value) && walk(entry.child, data, depth + 1, size, func))
+                return true;
+        }
+
+        return false;
+    }
+
+    template <typename Func>
+    inline void signature_set::operator()(region range, Func func) const
+    {
+        const byte* const base = range.start.as<const byte*>();
+        const std::size_t size = range.size;
+
+        if (!size || nodes_.empty())
+            return;
+
+        const std::uint64_t* const filter = filter_.data();
+
+        for (std::size_t pos = 0; pos + 1 < size; ++pos)
+        {
+            const std::uint32_t key = base[pos] | (static_cast<std::uint32_t>(base[pos + 1]) << 8);
+
+            if (MEM_LIKELY(!((filter[key >> 6] >> (key & 63)) & 1)))
+                continue;
+
+            if (walk(0, base + pos, 0, size - pos, func))
+                return;
+        }
+
+        if (has_short_)
+            walk(0, base + size - 1, 0, 1, func);
+    }
+
+    inline std::vector<multi_result> signature_set::scan_all(region range) const
+    {
+        std::vector<multi_result> results;
+
+        (*this)(range, [&results](std::size_t index, pointer address) {
+            results.push_back({index, address});
+
+            return false;
+        });
+
+        std::stable_sort(results.begin(), results.end(), [](const multi_result& lhs, const multi_result& rhs) {
+            return (lhs.address < rhs.address) || ((lhs.address == rhs.address) && (lhs.index < rhs.index));
+        });
+
+        return results;
+    }
+
+    MEM_STRONG_INLINE std::size_t signature_set::node_count() const noexcept
+    {
+        return nodes_.size();
+    }
+} // namespace mem
+
+#endif // MEM_SIGNATURE_SET_BRICK_H
@@ -23,10 +23,25 @@
 #include "pattern.h"
 
 #if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
-#    if defined(MEM_SIMD_AVX2)
+#    if defined(MEM_ARCH_X86) || defined(MEM_ARCH_X86_64)
+#        if defined(__GNUC__) && !defined(__clang__) && ((__GNUC__ < 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ < 9)))
+#            define MEM_SIMD_SCANNER_NO_DISPATCH
+#        endif
+#        if !defined(MEM_SIMD_SCANNER_NO_DISPATCH) || defined(MEM_SIMD_SSE2)
+#            define MEM_SIMD_SCANNER_HAS_SSE2
+#        endif
+#        if !defined(MEM_SIMD_SCANNER_NO_DISPATCH) || defined(MEM_SIMD_AVX2)
+#            define MEM_SIMD_SCANNER_HAS_AVX2
+#        endif
+#        if (!defined(MEM_SIMD_SCANNER_NO_DISPATCH) &&                                                 \
+             ((defined(__GNUC__) && (__GNUC__ >= 5)) || defined(__clang__) ||                          \
+                 (defined(_MSC_VER) && (_MSC_VER >= 1911)))) ||                                          \
+            defined(MEM_SIMD_AVX512BW)
+#            define MEM_SIMD_SCANNER_HAS_AVX512BW
+#        endif
+#    endif
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2) || defined(MEM_SIMD_SCANNER_HAS_AVX2)
 #        include <immintrin.h>
-#    elif defined(MEM_SIMD_SSE2)
-#        include <emmintrin.h>
 #    else
 #        define MEM_SIMD_SCANNER_USE_MEMCHR
 #    endif
@@ -41,31 +56,141 @@ namespace mem
     class simd_scanner : public scanner_base<simd_scanner>
     {
     private:
-        const pattern* pattern_ {nullptr};
+        pattern_view pattern_ {};
         std::size_t skip_pos_ {SIZE_MAX};
+        std::size_t pair_pos_ {SIZE_MAX};
 
     public:
         simd_scanner() = default;
 
-        simd_scanner(const pattern& pattern);
-        simd_scanner(const pattern& pattern, const byte* frequencies);
+        simd_scanner(pattern_view pattern);
+        simd_scanner(pattern_view pattern, const byte* frequencies, bool use_pairs = true);
+
+        // Reuses the anchors chosen by an earlier scanner for the same pattern, such as one stored in a signature_db
+        simd_scanner(pattern_view pattern, std::size_t skip_pos, std::size_t pair_pos) noexcept;
+
+        using scanner_base<simd_scanner>::operator();
+
+        // Calls func with each match until it returns true, without restarting the scan after each match
+        template <typename Func>
+        pointer operator()(region range, Func func) const;
 
         pointer scan(region range) const;
+        pointer rscan(region range) const;
+
+        pattern_view get_pattern() const noexcept;
+
+        std::size_t skip_pos() const noexcept;
+        std::size_t pair_pos() const noexcept;
 
         static const byte* default_frequencies() noexcept;
     };
 
     const byte* find_byte(const byte* ptr, byte value, std::size_t num);
+    const byte* find_pair(const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num);
+
+    // Returns the last occurrence of value in [ptr, ptr + num), or nullptr
+    const byte* rfind_byte(const byte* ptr, byte value, std::size_t num);
+
+    namespace internal
+    {
+        using find_byte_func = const byte* (*) (const byte* ptr, byte value, std::size_t num);
+        using find_pair_func = const byte* (*) (const byte* ptr, byte first, byte second, std::size_t distance,
+            std::size_t num);
+
+        struct simd_kernels
+        {
+            find_byte_func find_byte;
+            find_pair_func find_pair;
+            find_byte_func rfind_byte;
+        };
+
+        const byte* find_byte_memchr(const byte* ptr, byte value, std::size_t num);
+        const byte* find_pair_generic(const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num);
+        const byte* rfind_byte_generic(const byte* ptr, byte value, std::size_t num);
+
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+        const byte* find_byte_sse2(const byte* ptr, byte value, std::size_t num);
+        const byte* find_pair_sse2(const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num);
+        const byte* rfind_byte_sse2(const byte* ptr, byte value, std::size_t num);
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+        const byte* find_byte_avx2(const byte* ptr, byte value, std::size_t num);
+        const byte* find_pair_avx2(const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num);
+        const byte* rfind_byte_avx2(const byte* ptr, byte value, std::size_t num);
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX512BW)
+        const byte* find_byte_avx512bw(const byte* ptr, byte value, std::size_t num);
+        const byte* find_pair_avx512bw(
+            const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num);
+        const byte* rfind_byte_avx512bw(const byte* ptr, byte value, std::size_t num);
+#    endif
+#endif
 
-    inline simd_scanner::simd_scanner(const pattern& _pattern)
+        const simd_kernels& select_simd_kernels() noexcept;
+        const simd_kernels& get_simd_kernels() noexcept;
+    } // namespace internal
+
+    inline simd_scanner::simd_scanner(pattern_view _pattern)
         : simd_scanner(_pattern, default_frequencies())
     {}
 
-    inline simd_scanner::simd_scanner(const pattern& _pattern, const byte* frequencies)
-        : pattern_(&_pattern)
+    inline simd_scanner::simd_scanner(pattern_view _pattern, const byte* frequencies, bool use_pairs)
+        : pattern_(_pattern)
         , skip_pos_(_pattern.get_skip_pos(frequencies))
+    {
+        if (!use_pairs || (skip_pos_ == SIZE_MAX))
+            return;
+
+        // Pick a second anchor, so candidates can be filtered on both bytes at once
+        const byte* const bytes = _pattern.bytes();
+        const byte* const masks = _pattern.masks();
+
+        std::size_t min = SIZE_MAX;
+
+        for (std::size_t i = 0; i < _pattern.size(); ++i)
+        {
+            if ((i != skip_pos_) && (masks[i] == 0xFF))
+            {
+                const std::size_t f = frequencies[bytes[i]];
+
+                if (f <= min)
+                {
+                    pair_pos_ = i;
+                    min = f;
+                }
+            }
+        }
+
+        if ((pair_pos_ != SIZE_MAX) && (pair_pos_ < skip_pos_))
+            std::swap(pair_pos_, skip_pos_);
+    }
+
+    MEM_STRONG_INLINE simd_scanner::simd_scanner(
+        pattern_view _pattern, std::size_t skip_pos, std::size_t pair_pos) noexcept
+        : pattern_(_pattern)
+        , skip_pos_(skip_pos)
+        , pair_pos_(pair_pos)
     {}
 
+    MEM_STRONG_INLINE pattern_view simd_scanner::get_pattern() const noexcept
+    {
+        return pattern_;
+    }
+
+    MEM_STRONG_INLINE std::size_t simd_scanner::skip_pos() const noexcept
+    {
+        return skip_pos_;
+    }
+
+    MEM_STRONG_INLINE std::size_t simd_scanner::pair_pos() const noexcept
+    {
+        return pair_pos_;
+    }
+
     MEM_STRONG_INLINE const byte* simd_scanner::default_frequencies() noexcept
     {
         // clang-format off
@@ -93,14 +218,15 @@ namespace mem
         return frequencies;
     }
 
-    inline pointer simd_scanner::scan(region range) const
+    template <typename Func>
+    inline pointer simd_scanner::operator()(region range, Func func) const
     {
-        const std::size_t trimmed_size = pattern_->trimmed_size();
+        const std::size_t trimmed_size = pattern_.trimmed_size();
 
         if (!trimmed_size)
             return nullptr;
 
-        const std::size_t original_size = pattern_->size();
+        const std::size_t original_size = pattern_.size();
         const std::size_t region_size = range.size;
 
         if (original_size > region_size)
@@ -112,25 +238,62 @@ namespace mem
         const byte* current = region_base;
         const byte* const end = region_end - original_size + 1;
 
-        const std::size_t last = trimmed_size - 1;
-
-        const byte* const pat_bytes = pattern_->bytes();
+        const byte* const pat_bytes = pattern_.bytes();
 
         const std::size_t skip_pos = skip_pos_;
+        const std::size_t pair_pos = pair_pos_;
 
-        if (skip_pos != SIZE_MAX)
+        if (pair_pos != SIZE_MAX)
+        {
+            const byte first = pat_bytes[skip_pos];
+            const byte second = pat_bytes[pair_pos];
+            const std::size_t distance = pair_pos - skip_pos;
+
+            if (pattern_.needs_masks())
+            {
+                const byte* const pat_masks = pattern_.masks();
+
+                while (MEM_LIKELY(current < end))
+                {
+                    if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)) &&
+                        func(pointer(current)))
+                        return current;
+
+                    ++current;
+                    current = find_pair(current + skip_pos, first, second, distance,
+                                  static_cast<std::size_t>(end - current)) -
+                        skip_pos;
+                }
+
+                return nullptr;
+            }
+            else
+            {
+                while (MEM_LIKELY(current < end))
+                {
+                    if (MEM_UNLIKELY(internal::match_bytes(current, pat_bytes, trimmed_size)) && func(pointer(current)))
+                        return current;
+
+                    ++current;
+                    current = find_pair(current + skip_pos, first, second, distance,
+                                  static_cast<std::size_t>(end - current)) -
+                        skip_pos;
+                }
+
+                return nullptr;
+            }
+        }
+        else if (skip_pos != SIZE_MAX)
         {
-            if (pattern_->needs_masks())
+            if (pattern_.needs_masks())
             {
-                const byte* const pat_masks = pattern_->masks();
+                const byte* const pat_masks = pattern_.masks();
 
                 while (MEM_LIKELY(current < end))
                 {
-                    for (std::size_t i = last; MEM_LIKELY((current[i] & pat_masks[i]) == pat_bytes[i]); --i)
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
-                    }
+                    if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)) &&
+                        func(pointer(current)))
+                        return current;
 
                     ++current;
                     current =
@@ -144,11 +307,8 @@ namespace mem
             {
                 while (MEM_LIKELY(current < end))
                 {
-                    for (std::size_t i = last; MEM_LIKELY(current[i] == pat_bytes[i]); --i)
-                    {
-                        if (MEM_UNLIKELY(i == 0))
-                            return current;
-                    }
+                    if (MEM_UNLIKELY(internal::match_bytes(current, pat_bytes, trimmed_size)) && func(pointer(current)))
+                        return current;
 
                     ++current;
                     current =
@@ -161,15 +321,13 @@ namespace mem
         }
         else
         {
-            const byte* const pat_masks = pattern_->masks();
+            const byte* const pat_masks = pattern_.masks();
 
             while (MEM_LIKELY(current < end))
             {
-                for (std::size_t i = last; MEM_LIKELY((current[i] & pat_masks[i]) == pat_bytes[i]); --i)
-                {
-                    if (MEM_UNLIKELY(i == 0))
-                        return current;
-                }
+                if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)) &&
+                    func(pointer(current)))
+                    return current;
 
                 ++current;
             }
@@ -178,113 +336,464 @@ namespace mem
         }
     }
 
-    MEM_STRONG_INLINE const byte* find_byte(const byte* ptr, byte value, std::size_t num)
+    MEM_STRONG_INLINE pointer simd_scanner::scan(region range) const
     {
-#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
-#    if defined(MEM_SIMD_AVX2)
-#        define l_SIMD_TYPE __m256i
-#        define l_SIMD_FILL(x) _mm256_set1_epi8(static_cast<char>(x))
-#        define l_SIMD_LOAD(x) _mm256_loadu_si256(x)
-#        define l_SIMD_CMPEQ(x, y) _mm256_cmpeq_epi8(x, y)
-#        define l_SIMD_MOVEMASK(x) static_cast<unsigned int>(_mm256_movemask_epi8(x))
-#    elif defined(MEM_SIMD_SSE2)
-#        define l_SIMD_TYPE __m128i
-#        define l_SIMD_FILL(x) _mm_set1_epi8(static_cast<char>(x))
-#        define l_SIMD_LOAD(x) _mm_loadu_si128(x)
-#        define l_SIMD_CMPEQ(x, y) _mm_cmpeq_epi8(x, y)
-#        define l_SIMD_MOVEMASK(x) static_cast<unsigned int>(_mm_movemask_epi8(x))
-#    else
-#        error Sorry, No Potatoes
-#    endif
+        return (*this)(range, [](pointer) { return true; });
+    }
 
-#    define l_SIMD_SIZEOF(N) (sizeof(l_SIMD_TYPE) * N)
-#    define l_SIMD_CMPEQ_MASK(x, y) l_SIMD_MOVEMASK(l_SIMD_CMPEQ(x, y))
+    inline pointer simd_scanner::rscan(region range) const
+    {
+        const std::size_t trimmed_size = pattern_.trimmed_size();
 
-        if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))
-        {
-            const l_SIMD_TYPE simd_value = l_SIMD_FILL(value);
+        if (!trimmed_size)
+            return nullptr;
 
-            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(4)))
-            {
-                num -= l_SIMD_SIZEOF(4);
+        const std::size_t original_size = pattern_.size();
+        const std::size_t region_size = range.size;
+
+        if (original_size > region_size)
+            return nullptr;
 
-                const l_SIMD_TYPE value0 = l_SIMD_LOAD(reinterpret_cast<const l_SIMD_TYPE*>(ptr));
-                const l_SIMD_TYPE value1 = l_SIMD_LOAD(reinterpret_cast<const l_SIMD_TYPE*>(ptr + l_SIMD_SIZEOF(1)));
-                const l_SIMD_TYPE value2 = l_SIMD_LOAD(reinterpret_cast<const l_SIMD_TYPE*>(ptr + l_SIMD_SIZEOF(2)));
-                const l_SIMD_TYPE value3 = l_SIMD_LOAD(reinterpret_cast<const l_SIMD_TYPE*>(ptr + l_SIMD_SIZEOF(3)));
+        const byte* const region_base = range.start.as<const byte*>();
 
-                ptr += l_SIMD_SIZEOF(4);
+        // Number of candidate positions still to check, counting down from the end
+        std::size_t count = region_size - original_size + 1;
 
-                {
-                    const auto mask = l_SIMD_CMPEQ_MASK(value0, simd_value);
+        const byte* const pat_bytes = pattern_.bytes();
+        const byte* const pat_masks = pattern_.masks();
+        const bool needs_masks = pattern_.needs_masks();
 
-                    if (MEM_UNLIKELY(mask != 0))
-                        return ptr - l_SIMD_SIZEOF(4) + bsf(mask);
-                }
+        const std::size_t skip_pos = skip_pos_;
 
-                {
-                    const auto mask = l_SIMD_CMPEQ_MASK(value1, simd_value);
+        if (skip_pos != SIZE_MAX)
+        {
+            const byte skip_byte = pat_bytes[skip_pos];
 
-                    if (MEM_UNLIKELY(mask != 0))
-                        return ptr - l_SIMD_SIZEOF(3) + bsf(mask);
-                }
+            while (MEM_LIKELY(count != 0))
+            {
+                const byte* const found = rfind_byte(region_base + skip_pos, skip_byte, count);
 
-                {
-                    const auto mask = l_SIMD_CMPEQ_MASK(value2, simd_value);
+                if (found == nullptr)
+                    break;
 
-                    if (MEM_UNLIKELY(mask != 0))
-                        return ptr - l_SIMD_SIZEOF(2) + bsf(mask);
-                }
+                const byte* const current = found - skip_pos;
 
-                {
-                    const auto mask = l_SIMD_CMPEQ_MASK(value3, simd_value);
+                if (MEM_UNLIKELY(needs_masks ? internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)
+                                             : internal::match_bytes(current, pat_bytes, trimmed_size)))
+                    return current;
 
-                    if (MEM_UNLIKELY(mask != 0))
-                        return ptr - l_SIMD_SIZEOF(1) + bsf(mask);
-                }
+                count = static_cast<std::size_t>(current - region_base);
             }
 
-            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))
+            return nullptr;
+        }
+        else
+        {
+            while (MEM_LIKELY(count != 0))
             {
-                num -= l_SIMD_SIZEOF(1);
-
-                const auto mask = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(reinterpret_cast<const l_SIMD_TYPE*>(ptr)), simd_value);
+                const byte* const current = region_base + --count;
 
-                ptr += l_SIMD_SIZEOF(1);
-
-                if (MEM_UNLIKELY(mask != 0))
-                    return ptr - l_SIMD_SIZEOF(1) + bsf(mask);
+                if (MEM_UNLIKELY(internal::match_masked(current, pat_bytes, pat_masks, trimmed_size)))
+                    return current;
             }
+
+            return nullptr;
         }
+    }
+
+    inline const byte* internal::find_byte_memchr(const byte* ptr, byte value, std::size_t num)
+    {
+        const byte* result = static_cast<const byte*>(std::memchr(ptr, value, num));
+
+        if (MEM_UNLIKELY(result == nullptr))
+            result = ptr + num;
 
+        return result;
+    }
+
+    inline const byte* internal::find_pair_generic(
+        const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num)
+    {
         while (MEM_LIKELY(num != 0))
         {
-            --num;
+            const byte* const result = find_byte_memchr(ptr, first, num);
+
+            num -= static_cast<std::size_t>(result - ptr);
+            ptr = result;
 
-            if (MEM_UNLIKELY(*ptr == value))
-                return ptr;
+            if (MEM_UNLIKELY(num == 0) || (ptr[distance] == second))
+                break;
 
+            --num;
             ++ptr;
         }
 
         return ptr;
+    }
+
+    inline const byte* internal::rfind_byte_generic(const byte* ptr, byte value, std::size_t num)
+    {
+        while (MEM_LIKELY(num != 0))
+        {
+            --num;
+
+            if (MEM_UNLIKELY(ptr[num] == value))
+                return ptr + num;
+        }
+
+        return nullptr;
+    }
+
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+#    define l_FIND_BYTE_BODY()                                                                                        \
+        if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                                     \
+        {                                                                                                            \
+            const l_SIMD_TYPE simd_value = l_SIMD_FILL(value);                                                       \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(4)))                                                              \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(4);                                                                             \
+                                                                                                                     \
+                const l_SIMD_TYPE value0 = l_SIMD_LOAD(ptr);                                                         \
+                const l_SIMD_TYPE value1 = l_SIMD_LOAD(ptr + l_SIMD_SIZEOF(1));                                      \
+                const l_SIMD_TYPE value2 = l_SIMD_LOAD(ptr + l_SIMD_SIZEOF(2));                                      \
+                const l_SIMD_TYPE value3 = l_SIMD_LOAD(ptr + l_SIMD_SIZEOF(3));                                      \
+                                                                                                                     \
+                ptr += l_SIMD_SIZEOF(4);                                                                             \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value0, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr - l_SIMD_SIZEOF(4) + bsf(mask);                                                   \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value1, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr - l_SIMD_SIZEOF(3) + bsf(mask);                                                   \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value2, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr - l_SIMD_SIZEOF(2) + bsf(mask);                                                   \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value3, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr - l_SIMD_SIZEOF(1) + bsf(mask);                                                   \
+                }                                                                                                    \
+            }                                                                                                        \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                              \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                const auto mask = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr), simd_value);                                   \
+                                                                                                                     \
+                ptr += l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                if (MEM_UNLIKELY(mask != 0))                                                                         \
+                    return ptr - l_SIMD_SIZEOF(1) + bsf(mask);                                                       \
+            }                                                                                                        \
+        }                                                                                                            \
+                                                                                                                     \
+        while (MEM_LIKELY(num != 0))                                                                                 \
+        {                                                                                                            \
+            --num;                                                                                                   \
+                                                                                                                     \
+            if (MEM_UNLIKELY(*ptr == value))                                                                         \
+                return ptr;                                                                                          \
+                                                                                                                     \
+            ++ptr;                                                                                                   \
+        }                                                                                                            \
+                                                                                                                     \
+        return ptr;
+
+#    define l_FIND_PAIR_BODY()                                                                                        \
+        if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                                     \
+        {                                                                                                            \
+            const l_SIMD_TYPE simd_first = l_SIMD_FILL(first);                                                       \
+            const l_SIMD_TYPE simd_second = l_SIMD_FILL(second);                                                     \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(2)))                                                              \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(2);                                                                             \
+                                                                                                                     \
+                const auto mask0 = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr), simd_first) &                                 \
+                    l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr + distance), simd_second);                                     \
+                const auto mask1 = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr + l_SIMD_SIZEOF(1)), simd_first) &              \
+                    l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr + l_SIMD_SIZEOF(1) + distance), simd_second);                  \
+                                                                                                                     \
+                ptr += l_SIMD_SIZEOF(2);                                                                             \
+                                                                                                                     \
+                if (MEM_UNLIKELY(mask0 != 0))                                                                        \
+                    return ptr - l_SIMD_SIZEOF(2) + bsf(mask0);                                                      \
+                                                                                                                     \
+                if (MEM_UNLIKELY(mask1 != 0))                                                                        \
+                    return ptr - l_SIMD_SIZEOF(1) + bsf(mask1);                                                      \
+            }                                                                                                        \
+                                                                                                                     \
+            if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                                 \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                const auto mask = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr), simd_first) &                                  \
+                    l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr + distance), simd_second);                                     \
+                                                                                                                     \
+                ptr += l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                if (MEM_UNLIKELY(mask != 0))                                                                         \
+                    return ptr - l_SIMD_SIZEOF(1) + bsf(mask);                                                       \
+            }                                                                                                        \
+        }                                                                                                            \
+                                                                                                                     \
+        while (MEM_LIKELY(num != 0))                                                                                 \
+        {                                                                                                            \
+            --num;                                                                                                   \
+                                                                                                                     \
+            if (MEM_UNLIKELY((ptr[0] == first) && (ptr[distance] == second)))                                       \
+                return ptr;                                                                                          \
+                                                                                                                     \
+            ++ptr;                                                                                                   \
+        }                                                                                                            \
+                                                                                                                     \
+        return ptr;
+
+#    define l_RFIND_BYTE_BODY()                                                                                      \
+        if (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                                     \
+        {                                                                                                            \
+            const l_SIMD_TYPE simd_value = l_SIMD_FILL(value);                                                       \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(4)))                                                              \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(4);                                                                             \
+                                                                                                                     \
+                const l_SIMD_TYPE value0 = l_SIMD_LOAD(ptr + num);                                                   \
+                const l_SIMD_TYPE value1 = l_SIMD_LOAD(ptr + num + l_SIMD_SIZEOF(1));                                \
+                const l_SIMD_TYPE value2 = l_SIMD_LOAD(ptr + num + l_SIMD_SIZEOF(2));                                \
+                const l_SIMD_TYPE value3 = l_SIMD_LOAD(ptr + num + l_SIMD_SIZEOF(3));                                \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value3, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr + num + l_SIMD_SIZEOF(3) + bsr(mask);                                             \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value2, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr + num + l_SIMD_SIZEOF(2) + bsr(mask);                                             \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value1, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr + num + l_SIMD_SIZEOF(1) + bsr(mask);                                             \
+                }                                                                                                    \
+                                                                                                                     \
+                {                                                                                                    \
+                    const auto mask = l_SIMD_CMPEQ_MASK(value0, simd_value);                                         \
+                                                                                                                     \
+                    if (MEM_UNLIKELY(mask != 0))                                                                     \
+                        return ptr + num + bsr(mask);                                                                \
+                }                                                                                                    \
+            }                                                                                                        \
+                                                                                                                     \
+            while (MEM_LIKELY(num >= l_SIMD_SIZEOF(1)))                                                              \
+            {                                                                                                        \
+                num -= l_SIMD_SIZEOF(1);                                                                             \
+                                                                                                                     \
+                const auto mask = l_SIMD_CMPEQ_MASK(l_SIMD_LOAD(ptr + num), simd_value);                             \
+                                                                                                                     \
+                if (MEM_UNLIKELY(mask != 0))                                                                         \
+                    return ptr + num + bsr(mask);                                                                    \
+            }                                                                                                        \
+        }                                                                                                            \
+                                                                                                                     \
+        while (MEM_LIKELY(num != 0))                                                                                 \
+        {                                                                                                            \
+            --num;                                                                                                   \
+                                                                                                                     \
+            if (MEM_UNLIKELY(ptr[num] == value))                                                                     \
+                return ptr + num;                                                                                    \
+        }                                                                                                            \
+                                                                                                                     \
+        return nullptr;
+
+#    define l_SIMD_SIZEOF(N) (sizeof(l_SIMD_TYPE) * N)
+
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+#        define l_SIMD_TYPE __m128i
+#        define l_SIMD_FILL(x) _mm_set1_epi8(static_cast<char>(x))
+#        define l_SIMD_LOAD(x) _mm_loadu_si128(reinterpret_cast<const __m128i*>(x))
+#        define l_SIMD_CMPEQ_MASK(x, y) static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)))
+
+    MEM_TARGET("sse2") inline const byte* internal::find_byte_sse2(const byte* ptr, byte value, std::size_t num)
+    {
+        l_FIND_BYTE_BODY()
+    }
+
+    MEM_TARGET("sse2")
+    inline const byte* internal::find_pair_sse2(
+        const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num)
+    {
+        l_FIND_PAIR_BODY()
+    }
+
+    MEM_TARGET("sse2")
+    inline const byte* internal::rfind_byte_sse2(const byte* ptr, byte value, std::size_t num)
+    {
+        l_RFIND_BYTE_BODY()
+    }
+
+#        undef l_SIMD_TYPE
+#        undef l_SIMD_FILL
+#        undef l_SIMD_LOAD
+#        undef l_SIMD_CMPEQ_MASK
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+#        define l_SIMD_TYPE __m256i
+#        define l_SIMD_FILL(x) _mm256_set1_epi8(static_cast<char>(x))
+#        define l_SIMD_LOAD(x) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x))
+#        define l_SIMD_CMPEQ_MASK(x, y) static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)))
+
+    MEM_TARGET("avx2") inline const byte* internal::find_byte_avx2(const byte* ptr, byte value, std::size_t num)
+    {
+        l_FIND_BYTE_BODY()
+    }
+
+    MEM_TARGET("avx2")
+    inline const byte* internal::find_pair_avx2(
+        const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num)
+    {
+        l_FIND_PAIR_BODY()
+    }
+
+    MEM_TARGET("avx2")
+    inline const byte* internal::rfind_byte_avx2(const byte* ptr, byte value, std::size_t num)
+    {
+        l_RFIND_BYTE_BODY()
+    }
+
+#        undef l_SIMD_TYPE
+#        undef l_SIMD_FILL
+#        undef l_SIMD_LOAD
+#        undef l_SIMD_CMPEQ_MASK
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX512BW)
+#        define l_SIMD_TYPE __m512i
+#        define l_SIMD_FILL(x) _mm512_set1_epi8(static_cast<char>(x))
+#        define l_SIMD_LOAD(x) _mm512_loadu_si512(x)
+#        define l_SIMD_CMPEQ_MASK(x, y) static_cast<std::uint64_t>(_mm512_cmpeq_epi8_mask(x, y))
+
+    MEM_TARGET("avx512f,avx512bw")
+    inline const byte* internal::find_byte_avx512bw(const byte* ptr, byte value, std::size_t num)
+    {
+        l_FIND_BYTE_BODY()
+    }
+
+    MEM_TARGET("avx512f,avx512bw")
+    inline const byte* internal::find_pair_avx512bw(
+        const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num)
+    {
+        l_FIND_PAIR_BODY()
+    }
+
+    MEM_TARGET("avx512f,avx512bw")
+    inline const byte* internal::rfind_byte_avx512bw(const byte* ptr, byte value, std::size_t num)
+    {
+        l_RFIND_BYTE_BODY()
+    }
+
+#        undef l_SIMD_TYPE
+#        undef l_SIMD_FILL
+#        undef l_SIMD_LOAD
+#        undef l_SIMD_CMPEQ_MASK
+#    endif
 
-#    undef l_SIMD_TYPE
-#    undef l_SIMD_FILL
-#    undef l_SIMD_LOAD
-#    undef l_SIMD_LOADU
-#    undef l_SIMD_CMPEQ
-#    undef l_SIMD_MOVEMASK
 #    undef l_SIMD_SIZEOF
-#    undef l_SIMD_CMPEQ_MASK
-#else
-        const byte* result = static_cast<const byte*>(std::memchr(ptr, value, num));
+#    undef l_FIND_BYTE_BODY
+#    undef l_FIND_PAIR_BODY
+#    undef l_RFIND_BYTE_BODY
+#endif
 
-        if (MEM_UNLIKELY(result == nullptr))
-            result = ptr + num;
+    inline const internal::simd_kernels& internal::select_simd_kernels() noexcept
+    {
+        static constexpr const simd_kernels generic_kernels {
+            &find_byte_memchr, &find_pair_generic, &rfind_byte_generic};
 
-        return result;
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+        static constexpr const simd_kernels sse2_kernels {&find_byte_sse2, &find_pair_sse2, &rfind_byte_sse2};
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+        static constexpr const simd_kernels avx2_kernels {&find_byte_avx2, &find_pair_avx2, &rfind_byte_avx2};
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX512BW)
+        static constexpr const simd_kernels avx512bw_kernels {
+            &find_byte_avx512bw, &find_pair_avx512bw, &rfind_byte_avx512bw};
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_NO_DISPATCH)
+#        if defined(MEM_SIMD_AVX512BW)
+        return avx512bw_kernels;
+#        elif defined(MEM_SIMD_AVX2)
+        return avx2_kernels;
+#        else
+        return sse2_kernels;
+#        endif
+#    else
+        switch (get_simd_level())
+        {
+#        if defined(MEM_SIMD_SCANNER_HAS_AVX512BW)
+            case simd_level::avx512bw: return avx512bw_kernels;
+#        else
+            case simd_level::avx512bw:
+#        endif
+            case simd_level::avx2: return avx2_kernels;
+            case simd_level::sse2: return sse2_kernels;
+            case simd_level::none: break;
+        }
+#    endif
 #endif
+
+        return generic_kernels;
+    }
+
+    MEM_STRONG_INLINE const internal::simd_kernels& internal::get_simd_kernels() noexcept
+    {
+        static const simd_kernels& kernels = select_simd_kernels();
+
+        return kernels;
+    }
+
+    MEM_STRONG_INLINE const byte* find_byte(const byte* ptr, byte value, std::size_t num)
+    {
+        return internal::get_simd_kernels().find_byte(ptr, value, num);
+    }
+
+    MEM_STRONG_INLINE const byte* find_pair(
+        const byte* ptr, byte first, byte second, std::size_t distance, std::size_t num)
+    {
+        return internal::get_simd_kernels().find_pair(ptr, first, second, distance, num);
+    }
+
+    MEM_STRONG_INLINE const byte* rfind_byte(const byte* ptr, byte value, std::size_t num)
+    {
+        return internal::get_simd_kernels().rfind_byte(ptr, value, num);
     }
 } // namespace mem
 
@@ -0,0 +1,439 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_STATIC_PATTERN_BRICK_H
+#define MEM_STATIC_PATTERN_BRICK_H
+
+#include "pattern.h"
+
+#include <stdexcept>
+#include <type_traits>
+
+namespace mem
+{
+    namespace internal
+    {
+        // The same grammar as pattern::parse_chunk, written as C++11 constexpr functions.
+        // Recursion is per byte, so very long patterns may need a higher -fconstexpr-depth.
+        struct static_chunk
+        {
+            byte value;
+            byte mask;
+            std::size_t count;
+            std::size_t next;
+        };
+
+        constexpr std::size_t static_skip_spaces(const char* string, std::size_t pos)
+        {
+            return (string[pos] == ' ') ? static_skip_spaces(string, pos + 1) : pos;
+        }
+
+        constexpr static_chunk static_parse_digits(
+            const char* string, std::size_t pos, byte value, byte mask, std::size_t count)
+        {
+            return (dctoi(string[pos]) != -1)
+                ? static_parse_digits(
+                      string, pos + 1, value, mask, (count * 10) + static_cast<std::size_t>(dctoi(string[pos])))
+                : (count > 0) ? static_chunk {static_cast<byte>(value & mask), mask, count, pos}
+                              : throw std::invalid_argument("Invalid pattern repeat count");
+        }
+
+        constexpr static_chunk static_parse_count(const char* string, std::size_t pos, byte value, byte mask)
+        {
+            return (string[pos] == '#') ? static_parse_digits(string, pos + 1, value, mask, 0)
+                                        : static_chunk {static_cast<byte>(value & mask), mask, 1, pos};
+        }
+
+        constexpr static_chunk static_parse_mask(const char* string, std::size_t pos, byte value, byte mask)
+        {
+            return (string[pos] != '&')
+                ? static_parse_count(string, pos, value, mask)
+                : (xctoi(string[pos + 1]) == -1)
+                    ? throw std::invalid_argument("Invalid pattern mask")
+                    : (xctoi(string[pos + 2]) != -1)
+                        ? static_parse_count(string, pos + 3, value,
+                              static_cast<byte>(mask & ((xctoi(string[pos + 1]) << 4) | xctoi(string[pos + 2]))))
+                        : static_parse_count(
+                              string, pos + 2, value, static_cast<byte>(mask & xctoi(string[pos + 1])));
+        }
+
+        constexpr static_chunk static_parse_second(
+            const char* string, std::size_t pos, byte value, byte mask, char wildcard)
+        {
+            return (xctoi(string[pos]) != -1)
+                ? static_parse_mask(string, pos + 1, static_cast<byte>((value << 4) | xctoi(string[pos])),
+                      static_cast<byte>((mask << 4) | 0x0F))
+                : (string[pos] == wildcard)
+                    ? static_parse_mask(
+                          string, pos + 1, static_cast<byte>(value << 4), static_cast<byte>(mask << 4))
+                    : static_parse_mask(string, pos, value, mask);
+        }
+
+        constexpr static_chunk static_parse_chunk(const char* string, std::size_t pos, char wildcard)
+        {
+            return (xctoi(string[pos]) != -1)
+                ? static_parse_second(string, pos + 1, static_cast<byte>(xctoi(string[pos])), 0xFF, wildcard)
+                : (string[pos] == wildcard) ? static_parse_second(string, pos + 1, 0x00, 0x00, wildcard)
+                                            : throw std::invalid_argument("Invalid pattern");
+        }
+
+        constexpr bool static_at_end(const char* string, std::size_t pos)
+        {
+            return string[static_skip_spaces(string, pos)] == '\0';
+        }
+
+        constexpr static_chunk static_next_chunk(const char* string, std::size_t pos, char wildcard)
+        {
+            return static_parse_chunk(string, static_skip_spaces(string, pos), wildcard);
+        }
+
+        constexpr std::size_t static_pattern_size(const char* string, std::size_t pos = 0, char wildcard = '?');
+
+        constexpr std::size_t static_pattern_size_chunk(const char* string, static_chunk chunk, char wildcard)
+        {
+            return chunk.count + static_pattern_size(string, chunk.next, wildcard);
+        }
+
+        constexpr std::size_t static_pattern_size(const char* string, std::size_t pos, char wildcard)
+        {
+            return static_at_end(string, pos)
+                ? 0
+                : static_pattern_size_chunk(string, static_next_chunk(string, pos, wildcard), wildcard);
+        }
+
+        struct static_byte
+        {
+            byte value;
+            byte mask;
+        };
+
+        // The chunk holding the next byte: the same one while it has repeats left, otherwise the one after it
+        constexpr static_chunk static_advance(const char* string, static_chunk chunk, char wildcard)
+        {
+            return (chunk.count > 1) ? static_chunk {chunk.value, chunk.mask, chunk.count - 1, chunk.next}
+                                     : static_next_chunk(string, chunk.next, wildcard);
+        }
+
+        constexpr std::size_t static_trimmed_size(
+            const char* string, std::size_t pos, std::size_t offset, std::size_t result, char wildcard);
+
+        constexpr std::size_t static_trimmed_size_chunk(
+            const char* string, static_chunk chunk, std::size_t offset, std::size_t result, char wildcard)
+        {
+            return static_trimmed_size(
+                string, chunk.next, offset + chunk.count, chunk.mask ? (offset + chunk.count) : result, wildcard);
+        }
+
+        constexpr std::size_t static_trimmed_size(
+            const char* string, std::size_t pos, std::size_t offset, std::size_t result, char wildcard)
+        {
+            return static_at_end(string, pos)
+                ? result
+                : static_trimmed_size_chunk(string, static_next_chunk(string, pos, wildcard), offset, result, wildcard);
+        }
+
+        constexpr bool static_needs_masks(
+            const char* string, std::size_t pos, std::size_t offset, std::size_t trimmed_size, char wildcard);
+
+        constexpr bool static_needs_masks_chunk(
+            const char* string, static_chunk chunk, std::size_t offset, std::size_t trimmed_size, char wildcard)
+        {
+            return ((chunk.mask != 0xFF) && (offset < trimmed_size)) ||
+                static_needs_masks(string, chunk.next, offset + chunk.count, trimmed_size, wildcard);
+        }
+
+        constexpr bool static_needs_masks(
+            const char* string, std::size_t pos, std::size_t offset, std::size_t trimmed_size, char wildcard)
+        {
+            return !static_at_end(string, pos) &&
+                static_needs_masks_chunk(
+                    string, static_next_chunk(string, pos, wildcard), offset, trimmed_size, wildcard);
+        }
+    } // namespace internal
+
+    template <std::size_t N>
+    class static_pattern
+    {
+    private:
+        static constexpr const std::size_t padding_size {16};
+
+        byte bytes_[N + padding_size];
+        byte masks_[N + padding_size];
+        std::size_t trimmed_size_;
+        bool needs_masks_;
+
+        // Each step appends the byte of chunk and moves on to the next, so the string is parsed once, left to right
+        template <typename... Bytes>
+        constexpr static_pattern(std::false_type, const char* string, char wildcard, std::size_t trimmed_size,
+            internal::static_chunk chunk, Bytes... bytes);
+
+        template <typename... Bytes>
+        constexpr static_pattern(std::true_type, const char* string, char wildcard, std::size_t trimmed_size,
+            internal::static_chunk, Bytes... bytes);
+
+    public:
+        constexpr static_pattern(const char* string, char wildcard = '?');
+
+        bool match(pointer address) const noexcept;
+
+        constexpr const byte* bytes() const noexcept;
+        constexpr const byte* masks() const noexcept;
+
+        constexpr std::size_t size() const noexcept;
+        constexpr std::size_t trimmed_size() const noexcept;
+
+        constexpr bool needs_masks() const noexcept;
+
+        std::size_t get_skip_pos(const byte* frequencies) const noexcept;
+
+        pattern to_pattern() const;
+    };
+
+    template <std::size_t N>
+    constexpr const std::size_t static_pattern<N>::padding_size;
+
+    template <std::size_t N>
+    template <typename... Bytes>
+    MEM_STRONG_INLINE constexpr static_pattern<N>::static_pattern(std::false_type, const char* string, char wildcard,
+        std::size_t trimmed_size, internal::static_chunk chunk, Bytes... bytes)
+        : static_pattern(std::integral_constant<bool, (sizeof...(Bytes) + 1 == N)> {}, string, wildcard, trimmed_size,
+              (sizeof...(Bytes) + 1 < N) ? internal::static_advance(string, chunk, wildcard) : chunk, bytes...,
+              internal::static_byte {chunk.value, chunk.mask})
+    {}
+
+    template <std::size_t N>
+    template <typename... Bytes>
+    MEM_STRONG_INLINE constexpr static_pattern<N>::static_pattern(std::true_type, const char* string, char wildcard,
+        std::size_t trimmed_size, internal::static_chunk, Bytes... bytes)
+        : bytes_ {bytes.value...}
+        , masks_ {bytes.mask...}
+        , trimmed_size_(trimmed_size)
+        , needs_masks_(internal::static_needs_masks(string, 0, 0, trimmed_size, wildcard))
+    {}
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr static_pattern<N>::static_pattern(const char* string, char wildcard)
+        : static_pattern(std::integral_constant<bool, (N == 0)> {},
+              (internal::static_pattern_size(string, 0, wildcard) == N)
+                  ? string
+                  : throw std::length_error("Pattern size mismatch"),
+              wildcard, internal::static_trimmed_size(string, 0, 0, 0, wildcard),
+              (N != 0) ? internal::static_next_chunk(string, 0, wildcard) : internal::static_chunk {0x00, 0x00, 0, 0})
+    {}
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE bool static_pattern<N>::match(pointer address) const noexcept
+    {
+        // N is a constant, so the compare is fully unrolled for short patterns
+        return internal::match_masked(address.as<const byte*>(), bytes_, masks_, N);
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr const byte* static_pattern<N>::bytes() const noexcept
+    {
+        return bytes_;
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr const byte* static_pattern<N>::masks() const noexcept
+    {
+        return masks_;
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr std::size_t static_pattern<N>::size() const noexcept
+    {
+        return N;
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr std::size_t static_pattern<N>::trimmed_size() const noexcept
+    {
+        return trimmed_size_;
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE constexpr bool static_pattern<N>::needs_masks() const noexcept
+    {
+        return needs_masks_;
+    }
+
+    template <std::size_t N>
+    inline std::size_t static_pattern<N>::get_skip_pos(const byte* frequencies) const noexcept
+    {
+        std::size_t min = SIZE_MAX;
+        std::size_t result = SIZE_MAX;
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (masks_[i] == 0xFF)
+            {
+                std::size_t f = frequencies[bytes_[i]];
+
+                if (f <= min)
+                {
+                    result = i;
+                    min = f;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    template <std::size_t N>
+    inline pattern static_pattern<N>::to_pattern() const
+    {
+        return pattern(bytes_, masks_, N);
+    }
+
+    template <std::size_t N>
+    class static_scanner : public scanner_base<static_scanner<N>>
+    {
+    private:
+        const static_pattern<N>* pattern_ {nullptr};
+        std::size_t skip_pos_ {SIZE_MAX};
+
+    public:
+        static_scanner() = default;
+
+        static_scanner(const static_pattern<N>& pattern);
+        static_scanner(const static_pattern<N>& pattern, const byte* frequencies);
+
+        using scanner_base<static_scanner<N>>::operator();
+
+        // Calls func with each match until it returns true, without restarting the scan after each match
+        template <typename Func>
+        pointer operator()(region range, Func func) const;
+
+        pointer scan(region range) const;
+        pointer rscan(region range) const;
+    };
+
+    template <std::size_t N>
+    inline static_scanner<N>::static_scanner(const static_pattern<N>& _pattern)
+        : static_scanner(_pattern, simd_scanner::default_frequencies())
+    {}
+
+    template <std::size_t N>
+    inline static_scanner<N>::static_scanner(const static_pattern<N>& _pattern, const byte* frequencies)
+        : pattern_(&_pattern)
+        , skip_pos_(_pattern.get_skip_pos(frequencies))
+    {}
+
+    template <std::size_t N>
+    template <typename Func>
+    inline pointer static_scanner<N>::operator()(region range, Func func) const
+    {
+        if (!pattern_->trimmed_size())
+            return nullptr;
+
+        if (N > range.size)
+            return nullptr;
+
+        const byte* current = range.start.as<const byte*>();
+        const byte* const end = current + range.size - N + 1;
+
+        const std::size_t skip_pos = skip_pos_;
+
+        if (skip_pos != SIZE_MAX)
+        {
+            const byte skip_byte = pattern_->bytes()[skip_pos];
+
+            while (MEM_LIKELY(current < end))
+            {
+                if (MEM_UNLIKELY(pattern_->match(current)) && func(pointer(current)))
+                    return current;
+
+                ++current;
+                current = find_byte(current + skip_pos, skip_byte, static_cast<std::size_t>(end - current)) - skip_pos;
+            }
+        }
+        else
+        {
+            while (MEM_LIKELY(current < end))
+            {
+                if (MEM_UNLIKELY(pattern_->match(current)) && func(pointer(current)))
+                    return current;
+
+                ++current;
+            }
+        }
+
+        return nullptr;
+    }
+
+    template <std::size_t N>
+    MEM_STRONG_INLINE pointer static_scanner<N>::scan(region range) const
+    {
+        return (*this)(range, [](pointer) { return true; });
+    }
+
+    template <std::size_t N>
+    inline pointer static_scanner<N>::rscan(region range) const
+    {
+        if (!pattern_->trimmed_size())
+            return nullptr;
+
+        if (N > range.size)
+            return nullptr;
+
+        const byte* const start = range.start.as<const byte*>();
+
+        std::size_t count = range.size - N + 1;
+
+        const std::size_t skip_pos = skip_pos_;
+
+        if (skip_pos != SIZE_MAX)
+        {
+            const byte skip_byte = pattern_->bytes()[skip_pos];
+
+            while (MEM_LIKELY(count != 0))
+            {
+                const byte* const found = rfind_byte(start + skip_pos, skip_byte, count);
+
+                if (found == nullptr)
+                    break;
+
+                const byte* const current = found - skip_pos;
+
+                if (MEM_UNLIKELY(pattern_->match(current)))
+                    return current;
+
+                count = static_cast<std::size_t>(current - start);
+            }
+        }
+        else
+        {
+            while (MEM_LIKELY(count != 0))
+            {
+                const byte* const current = start + --count;
+
+                if (MEM_UNLIKELY(pattern_->match(current)))
+                    return current;
+            }
+        }
+
+        return nullptr;
+    }
+} // namespace mem
+
+#define MEM_STATIC_PATTERN(string) (::mem::static_pattern<::mem::internal::static_pattern_size(string)>(string))
+
+#endif // MEM_STATIC_PATTERN_BRICK_H
@@ -0,0 +1,170 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_STREAM_SCANNER_BRICK_H
+#define MEM_STREAM_SCANNER_BRICK_H
+
+#include "pattern.h"
+
+#include <cstring>
+
+namespace mem
+{
+    // Scans input which arrives in pieces, reporting offsets relative to the start of the stream.
+    // Only the last pattern.size() - 1 bytes of the previous chunks are kept between calls.
+    template <typename Scanner = default_scanner>
+    class stream_scanner
+    {
+    private:
+        Scanner scanner_ {};
+        std::size_t overlap_ {0};
+
+        std::vector<byte> buffer_ {};
+        std::size_t tail_size_ {0};
+        std::uint64_t offset_ {0};
+
+        void update_tail(region chunk);
+
+    public:
+        stream_scanner() = default;
+
+        stream_scanner(pattern_view pattern);
+
+        // Calls func(offset) for each match completed by this chunk, stopping early if it returns true.
+        // The stream still advances past the whole chunk when stopped.
+        template <typename Func>
+        bool feed(region chunk, Func func);
+
+        std::vector<std::uint64_t> feed_all(region chunk);
+
+        void reset() noexcept;
+
+        std::uint64_t offset() const noexcept;
+    };
+
+    template <typename Scanner>
+    inline stream_scanner<Scanner>::stream_scanner(pattern_view _pattern)
+        : scanner_(_pattern)
+        , overlap_(_pattern.size() ? (_pattern.size() - 1) : 0)
+    {
+        buffer_.reserve(overlap_ * 2);
+    }
+
+    template <typename Scanner>
+    template <typename Func>
+    inline bool stream_scanner<Scanner>::feed(region chunk, Func func)
+    {
+        bool stopped = false;
+
+        if (!chunk.size)
+            return stopped;
+
+        if (tail_size_)
+        {
+            // Matches starting in the tail and ending in this chunk
+            const std::size_t head_size = (chunk.size < overlap_) ? chunk.size : overlap_;
+
+            buffer_.resize(tail_size_ + head_size);
+            std::memcpy(buffer_.data() + tail_size_, chunk.start.as<const void*>(), head_size);
+
+            const std::uint64_t base = offset_ - tail_size_;
+            const std::size_t tail_size = tail_size_;
+
+            scanner_(region(buffer_.data(), buffer_.size()), [&](pointer result) {
+                const std::size_t index = static_cast<std::size_t>(result - buffer_.data());
+
+                if (index >= tail_size)
+                    return true;
+
+                stopped = func(base + index);
+
+                return stopped;
+            });
+        }
+
+        if (!stopped)
+        {
+            const pointer start = chunk.start;
+            const std::uint64_t base = offset_;
+
+            scanner_(chunk, [&](pointer result) {
+                stopped = func(base + static_cast<std::uint64_t>(result - start));
+
+                return stopped;
+            });
+        }
+
+        update_tail(chunk);
+
+        return stopped;
+    }
+
+    template <typename Scanner>
+    inline void stream_scanner<Scanner>::update_tail(region chunk)
+    {
+        offset_ += chunk.size;
+
+        if (chunk.size >= overlap_)
+        {
+            buffer_.resize(overlap_);
+            std::memcpy(buffer_.data(), (chunk.start + (chunk.size - overlap_)).as<const void*>(), overlap_);
+        }
+        else
+        {
+            // Small chunks extend the current tail rather than replacing it
+            buffer_.resize(tail_size_ + chunk.size);
+            std::memcpy(buffer_.data() + tail_size_, chunk.start.as<const void*>(), chunk.size);
+
+            if (buffer_.size() > overlap_)
+                buffer_.erase(buffer_.begin(), buffer_.end() - static_cast<std::ptrdiff_t>(overlap_));
+        }
+
+        tail_size_ = buffer_.size();
+    }
+
+    template <typename Scanner>
+    inline std::vector<std::uint64_t> stream_scanner<Scanner>::feed_all(region chunk)
+    {
+        std::vector<std::uint64_t> results;
+
+        feed(chunk, [&results](std::uint64_t result) {
+            results.emplace_back(result);
+
+            return false;
+        });
+
+        return results;
+    }
+
+    template <typename Scanner>
+    inline void stream_scanner<Scanner>::reset() noexcept
+    {
+        buffer_.clear();
+        tail_size_ = 0;
+        offset_ = 0;
+    }
+
+    template <typename Scanner>
+    MEM_STRONG_INLINE std::uint64_t stream_scanner<Scanner>::offset() const noexcept
+    {
+        return offset_;
+    }
+} // namespace mem
+
+#endif // MEM_STREAM_SCANNER_BRICK_H
@@ -0,0 +1,305 @@
+/*
+    Copyright 2018 Brick
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+    and associated documentation files (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge, publish, distribute,
+    sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all copies or
+    substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+    BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+    DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MEM_X86_DECODER_BRICK_H
+#define MEM_X86_DECODER_BRICK_H
+
+#include "defines.h"
+
+namespace mem
+{
+    struct x86_instruction
+    {
+        std::size_t length {0};
+
+        std::size_t disp_offset {0};
+        std::size_t disp_size {0};
+
+        std::size_t imm_offset {0};
+        std::size_t imm_size {0};
+
+        // The displacement is relative to the next instruction
+        bool rip_relative {false};
+
+        // The immediate is a branch displacement
+        bool relative {false};
+    };
+
+    // Decodes the length and layout of a 64-bit mode instruction. Returns false if it is invalid or truncated.
+    bool decode_x86_64(const byte* code, std::size_t size, x86_instruction& result) noexcept;
+
+    namespace internal
+    {
+        constexpr const byte x86_modrm {0x01};
+        constexpr const byte x86_imm8 {0x02};
+        constexpr const byte x86_imm16 {0x04};
+        constexpr const byte x86_immz {0x08};
+        constexpr const byte x86_relative {0x10};
+        constexpr const byte x86_invalid {0x20};
+        constexpr const byte x86_moffs {0x40};
+        constexpr const byte x86_group3 {0x80};
+
+        // Operand flags for the one byte opcode map, and the 0F map. Prefixes and escapes are handled separately.
+        const byte* x86_one_byte_flags() noexcept;
+        const byte* x86_two_byte_flags() noexcept;
+    } // namespace internal
+
+    MEM_STRONG_INLINE const byte* internal::x86_one_byte_flags() noexcept
+    {
+        // clang-format off
+        static constexpr const byte flags[256]
+        {
+            0x01,0x01,0x01,0x01,0x02,0x08,0x20,0x20,0x01,0x01,0x01,0x01,0x02,0x08,0x20,0x00,
+            0x01,0x01,0x01,0x01,0x02,0x08,0x20,0x20,0x01,0x01,0x01,0x01,0x02,0x08,0x20,0x20,
+            0x01,0x01,0x01,0x01,0x02,0x08,0x00,0x20,0x01,0x01,0x01,0x01,0x02,0x08,0x00,0x20,
+            0x01,0x01,0x01,0x01,0x02,0x08,0x00,0x20,0x01,0x01,0x01,0x01,0x02,0x08,0x00,0x20,
+            0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+            0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+            0x20,0x20,0x20,0x01,0x00,0x00,0x00,0x00,0x08,0x09,0x02,0x03,0x00,0x00,0x00,0x00,
+            0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,0x12,
+            0x03,0x09,0x20,0x03,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x00,0x00,
+            0x40,0x40,0x40,0x40,0x00,0x00,0x00,0x00,0x02,0x08,0x00,0x00,0x00,0x00,0x00,0x00,
+            0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,
+            0x03,0x03,0x04,0x00,0x00,0x00,0x03,0x09,0x06,0x00,0x04,0x00,0x00,0x02,0x20,0x00,
+            0x01,0x01,0x01,0x01,0x20,0x20,0x20,0x00,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x12,0x12,0x12,0x12,0x02,0x02,0x02,0x02,0x18,0x18,0x20,0x12,0x00,0x00,0x00,0x00,
+            0x00,0x00,0x00,0x00,0x00,0x00,0x81,0x81,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,
+        };
+        // clang-format on
+
+        return flags;
+    }
+
+    MEM_STRONG_INLINE const byte* internal::x86_two_byte_flags() noexcept
+    {
+        // clang-format off
+        static constexpr const byte flags[256]
+        {
+            0x01,0x01,0x01,0x01,0x20,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x20,0x01,0x00,0x03,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x20,0x20,0x20,0x20,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x20,0x20,0x20,0x20,0x20,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x03,0x03,0x03,0x03,0x01,0x01,0x01,0x00,0x01,0x01,0x20,0x20,0x01,0x01,0x01,0x01,
+            0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x00,0x00,0x00,0x01,0x03,0x01,0x20,0x20,0x00,0x00,0x00,0x01,0x03,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x03,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x03,0x01,0x03,0x03,0x03,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+            0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+        };
+        // clang-format on
+
+        return flags;
+    }
+
+    inline bool decode_x86_64(const byte* code, std::size_t size, x86_instruction& result) noexcept
+    {
+        result = x86_instruction();
+
+        if (size > 15)
+            size = 15;
+
+        std::size_t pos = 0;
+
+        bool operand_size = false;
+        bool address_size = false;
+        bool rex_w = false;
+
+        for (; pos < size; ++pos)
+        {
+            const byte value = code[pos];
+
+            // A REX prefix is ignored unless it directly precedes the opcode
+            if ((value & 0xF0) == 0x40)
+            {
+                rex_w = (value & 0x08) != 0;
+
+                continue;
+            }
+
+            if (value == 0x66)
+                operand_size = true;
+            else if (value == 0x67)
+                address_size = true;
+            else if ((value != 0x26) && (value != 0x2E) && (value != 0x36) && (value != 0x3E) && (value != 0x64) &&
+                     (value != 0x65) && (value != 0xF0) && (value != 0xF2) && (value != 0xF3))
+                break;
+
+            rex_w = false;
+        }
+
+        if (pos >= size)
+            return false;
+
+        byte opcode = code[pos++];
+        byte flags = 0;
+
+        bool one_byte = false;
+
+        if (opcode == 0x0F)
+        {
+            if (pos >= size)
+                return false;
+
+            opcode = code[pos++];
+
+            if ((opcode == 0x38) || (opcode == 0x3A))
+            {
+                if (pos >= size)
+                    return false;
+
+                flags = (opcode == 0x3A) ? (internal::x86_modrm | internal::x86_imm8) : internal::x86_modrm;
+
+                ++pos;
+            }
+            else
+            {
+                flags = internal::x86_two_byte_flags()[opcode];
+            }
+        }
+        else if ((opcode == 0xC4) || (opcode == 0xC5) || (opcode == 0x62))
+        {
+            // VEX and EVEX prefixes carry the opcode map
+            const std::size_t payload = (opcode == 0xC5) ? 1 : (opcode == 0xC4) ? 2 : 3;
+
+            if ((size - pos) <= payload)
+                return false;
+
+            const std::size_t map = (opcode == 0xC5) ? 1 : (code[pos] & ((opcode == 0x62) ? 0x07 : 0x1F));
+
+            pos += payload;
+            opcode = code[pos++];
+
+            switch (map)
+            {
+                case 1: flags = internal::x86_two_byte_flags()[opcode]; break;
+                case 2: flags = internal::x86_modrm; break;
+                case 3: flags = internal::x86_modrm | internal::x86_imm8; break;
+                case 5: flags = internal::x86_modrm; break;
+                case 6: flags = internal::x86_modrm; break;
+                default: return false;
+            }
+
+            if (flags & internal::x86_relative)
+                return false;
+        }
+        else
+        {
+            flags = internal::x86_one_byte_flags()[opcode];
+
+            one_byte = true;
+        }
+
+        if (flags & internal::x86_invalid)
+            return false;
+
+        std::size_t disp_size = 0;
+
+        if (flags & internal::x86_modrm)
+        {
+            if (pos >= size)
+                return false;
+
+            const byte modrm = code[pos++];
+
+            const unsigned mod = modrm >> 6;
+            const unsigned rm = modrm & 0x7;
+
+            if (mod != 3)
+            {
+                if (rm == 4)
+                {
+                    if (pos >= size)
+                        return false;
+
+                    if ((mod == 0) && ((code[pos] & 0x7) == 5))
+                        disp_size = 4;
+
+                    ++pos;
+                }
+                else if ((mod == 0) && (rm == 5))
+                {
+                    disp_size = 4;
+
+                    result.rip_relative = true;
+                }
+
+                if (mod == 1)
+                    disp_size = 1;
+                else if (mod == 2)
+                    disp_size = 4;
+            }
+
+            // TEST has an immediate, unlike the rest of its group
+            if ((flags & internal::x86_group3) && (((modrm >> 3) & 0x7) < 2))
+                flags |= (opcode == 0xF6) ? internal::x86_imm8 : internal::x86_immz;
+        }
+
+        std::size_t imm_size = 0;
+
+        if (flags & internal::x86_moffs)
+        {
+            imm_size = address_size ? 4 : 8;
+        }
+        else
+        {
+            if (flags & internal::x86_imm16)
+                imm_size += 2;
+
+            if (flags & internal::x86_imm8)
+                imm_size += 1;
+
+            if (flags & internal::x86_immz)
+            {
+                if (flags & internal::x86_relative)
+                    imm_size += 4;
+                else if (one_byte && rex_w && (opcode >= 0xB8) && (opcode <= 0xBF))
+                    imm_size += 8;
+                else
+                    imm_size += operand_size ? 2 : 4;
+            }
+        }
+
+        result.disp_offset = pos;
+        result.disp_size = disp_size;
+
+        pos += disp_size;
+
+        result.imm_offset = pos;
+        result.imm_size = imm_size;
+        result.relative = (flags & internal::x86_relative) != 0;
+
+        pos += imm_size;
+
+        if (pos > size)
+            return false;
+
+        result.length = pos;
+
+        return true;
+    }
+} // namespace mem
+
+#endif // MEM_X86_DECODER_BRICK_H
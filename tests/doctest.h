@@ -3847,7 +3847,7 @@ namespace detail {
         other.numCaptures = 0;
         other.head        = nullptr;
         other.tail        = nullptr;
-        memcpy(stackChunks, other.stackChunks,
+        memcpy(static_cast<void*>(stackChunks), other.stackChunks,
                unsigned(int(sizeof(Chunk)) * DOCTEST_CONFIG_NUM_CAPTURES_ON_STACK));
     }
 
@@ -3995,7 +3995,7 @@ namespace {
         static bool             isSet;
         static struct sigaction oldSigActions[DOCTEST_COUNTOF(signalDefs)];
         static stack_t          oldSigStack;
-        static char             altStackMem[4 * SIGSTKSZ];
+        static char             altStackMem[4 * 8192];
 
         static void handleSignal(int sig) {
             const char* name = "<unknown signal>";
@@ -31,14 +31,28 @@
 
 #include <mem/pattern.h>
 #include <mem/pattern_cache.h>
+#include <mem/byte_frequencies.h>
+#include <mem/static_pattern.h>
+#include <mem/extended_pattern.h>
 
 #include <mem/simd_scanner.h>
 #include <mem/boyer_moore_scanner.h>
+#include <mem/auto_scanner.h>
+#include <mem/multi_scanner.h>
+#include <mem/signature_set.h>
+#include <mem/signature_file.h>
+#include <mem/signature_db.h>
+#include <mem/parallel_scanner.h>
+#include <mem/stream_scanner.h>
+#include <mem/hamming_scanner.h>
+#include <mem/x86_decoder.h>
+#include <mem/sig_maker.h>
 
 #include <mem/prot_flags.h>
 #include <mem/protect.h>
 
 #include <mem/module.h>
+#include <mem/file_module.h>
 #include <mem/aligned_alloc.h>
 #include <mem/execution_handler.h>
 
@@ -48,7 +62,12 @@
 # include <mem/rtti.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_set>
 
 #include "doctest.h"
@@ -91,103 +110,1638 @@ TEST_CASE("mem::pattern constructor")
 
     CHECK_NOTHROW(check_pattern(mem::pattern("\x12\x34\x56\x78\xAB", "\xFF\x00\xFF\xFF\x00", 5), 5, 4, true, "\x12\x00\x56\x78\x00", "\xFF\x00\xFF\xFF\x00"));
     CHECK_NOTHROW(check_pattern(mem::pattern("\x12\x34\x56\x78\xAB", nullptr, 5), 5, 5, false, "\x12\x34\x56\x78\xAB", "\xFF\xFF\xFF\xFF\xFF"));
+
+    // Repeat counts which overflow, or add up to more than the largest pattern, are rejected
+    REQUIRE(mem::pattern("?#16777215 AA").size() == 16777216);
+    REQUIRE(!mem::pattern("AA#18446744073709551615 BB"));
+    REQUIRE(!mem::pattern("AA#18446744073709551616"));
+    REQUIRE(!mem::pattern("AA#16777217"));
+    REQUIRE(!mem::pattern("AA#16777216 BB"));
+    REQUIRE(!mem::pattern("?#9223372036854775808 ?#9223372036854775808 BB"));
+}
+
+void check_pattern_results(mem::region whole_region, const mem::pattern& pattern, const std::vector<uint8_t>& scan_data, const std::unordered_set<size_t>& offsets)
+{
+    REQUIRE(scan_data.size() <= whole_region.size);
+
+    mem::region scan_region = whole_region.sub_region(whole_region.start.add(whole_region.size - scan_data.size()));
+
+    REQUIRE(scan_region.start == whole_region.start.add(whole_region.size - scan_data.size()));
+    REQUIRE(scan_region.size == scan_data.size());
+
+    if (!scan_data.empty())
+        scan_region.copy(scan_data.data());
+
+    mem::default_scanner scanner(pattern);
+
+    auto scan_results = scanner.scan_all(whole_region);
+
+    REQUIRE(scan_results.size() == offsets.size());
+
+    std::unordered_set<size_t> scan_results_set;
+
+    for (auto result : scan_results)
+    {
+        scan_results_set.emplace(result - scan_region.start);
+    }
+
+    REQUIRE(scan_results_set.size() == offsets.size());
+
+    for (auto expected : offsets)
+    {
+        REQUIRE(scan_results_set.find(expected) != scan_results_set.end());
+    }
+}
+
+TEST_CASE("mem::pattern copy")
+{
+    std::string large_string;
+
+    for (size_t i = 0; i < 100; ++i)
+        large_string += (i % 3) ? "4? " : "? ";
+
+    // Inline and heap allocated storage
+    for (const char* string : {"01 02 ? 04", "01 ?2 ? 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F 20", large_string.c_str()})
+    {
+        const mem::pattern original(string);
+
+        const std::string text = original.to_string();
+
+        mem::pattern copy(original);
+
+        REQUIRE(copy.to_string() == text);
+        REQUIRE(copy.bytes() != original.bytes());
+
+        // The padding past the end is copied too
+        REQUIRE(copy.masks()[copy.size()] == 0x00);
+
+        mem::pattern moved(std::move(copy));
+
+        REQUIRE(moved.to_string() == text);
+        REQUIRE(moved.trimmed_size() == original.trimmed_size());
+        REQUIRE(moved.needs_masks() == original.needs_masks());
+        REQUIRE(!copy);
+
+        mem::pattern assigned("FF");
+
+        assigned = original;
+        REQUIRE(assigned.to_string() == text);
+
+        assigned = mem::pattern("01 02");
+        REQUIRE(assigned.to_string() == "01 02");
+
+        assigned = std::move(moved);
+        REQUIRE(assigned.to_string() == text);
+
+        const mem::pattern& self = assigned;
+
+        assigned = self;
+        REQUIRE(assigned.to_string() == text);
+    }
+
+    std::vector<mem::pattern> patterns;
+
+    for (size_t i = 0; i < 100; ++i)
+        patterns.emplace_back((i % 2) ? "01 02 03" : large_string.c_str());
+
+    for (size_t i = 0; i < patterns.size(); ++i)
+        REQUIRE(patterns[i].to_string() == mem::pattern((i % 2) ? "01 02 03" : large_string.c_str()).to_string());
+}
+
+TEST_CASE("mem::signature_file")
+{
+    const char* const strings[] {
+        "01 02 03 04 05", "01 02 03 04 ?", " 01    02        03 04 05 ", "1 ?2 3 4? 5", "1? ? 3 ?? 5?", "?1 ? 3 ?? ?5",
+        "01?12???34", "01 02 03#3 04 05", "01 02 03&F#3 04 05", "01 02 33&F0#3 04 05", "01 02 03&F", "01 02 03#12",
+        "12345678", "? 01 02 03 04 ? ? ?", "E8 [rel32] ? 48 [rel8+1] 00",
+    };
+
+    std::string text = "# Comment\n\n";
+
+    for (size_t i = 0; i < 15; ++i)
+        text += "  name " + std::to_string(i) + " \t= " + strings[i] + ((i % 2) ? "\r\n" : "\n");
+
+    text += "empty =\n";
+    text += "= 01 02\n";
+    text += "invalid = 01 02 XY\n";
+    text += "mask = 01 02&\n";
+    text += "missing 01 02\n";
+    text += "repeat = 01#0 02\n";
+    text += "overflow = AA#18446744073709551615 BB\n";
+    text += "large = 01 ?#16777216\n";
+    text += "capture = E8 [rel16]";
+
+    mem::signature_file file;
+
+    REQUIRE(!file.load(text.data(), text.size()));
+    REQUIRE(file.size() == 15);
+    REQUIRE(file.names().size() == 15);
+
+    for (size_t i = 0; i < 15; ++i)
+    {
+        const mem::pattern expected(strings[i]);
+
+        REQUIRE(file.names()[i] == "name " + std::to_string(i));
+        REQUIRE(file.patterns()[i].to_string() == expected.to_string());
+        REQUIRE(file.patterns()[i].trimmed_size() == expected.trimmed_size());
+        REQUIRE(file.patterns()[i].needs_masks() == expected.needs_masks());
+    }
+
+    const mem::signature_error expected_errors[] {
+        {18, 8, "Expected pattern"},
+        {19, 1, "Expected name"},
+        {20, 17, "Invalid character"},
+        {21, 14, "Expected mask"},
+        {22, 14, "Expected '='"},
+        {23, 14, "Expected repeat count"},
+        {24, 22, "Repeat count too large"},
+        {25, 22, "Repeat count too large"},
+        {26, 20, "Invalid capture"},
+    };
+
+    REQUIRE(file.errors().size() == 9);
+
+    for (size_t i = 0; i < 9; ++i)
+    {
+        REQUIRE(file.errors()[i].line == expected_errors[i].line);
+        REQUIRE(file.errors()[i].column == expected_errors[i].column);
+        REQUIRE(std::string(file.errors()[i].message) == expected_errors[i].message);
+    }
+
+    REQUIRE(file.load("a = 01\nb = 02", 13));
+    REQUIRE(file.size() == 2);
+    REQUIRE(file.errors().empty());
+}
+
+TEST_CASE("mem::signature_db")
+{
+    std::vector<uint8_t> data(0x4000);
+
+    uint32_t seed = 0x9E3779B9;
+
+    auto next = [&seed] {
+        seed = (seed * 1103515245) + 12345;
+
+        return seed >> 16;
+    };
+
+    // Mostly common bytes, so some patterns use Boyer-Moore
+    for (auto& value : data)
+        value = (next() % 4) ? static_cast<uint8_t>((next() % 2) ? 0x00 : 0x48) : static_cast<uint8_t>(next());
+
+    std::vector<std::string> names;
+    std::vector<mem::pattern> patterns;
+
+    const mem::byte mask_choices[] {0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xF0};
+
+    for (size_t i = 0; i < 60; ++i)
+    {
+        const size_t length = 1 + (next() % 300);
+        const size_t offset = next() % (data.size() - length);
+
+        std::vector<mem::byte> masks(length);
+
+        for (mem::byte& mask : masks)
+            mask = (i % 3) ? mask_choices[next() % 6] : 0xFF;
+
+        names.push_back("pattern " + std::to_string(i));
+        patterns.emplace_back(&data[offset], masks.data(), length);
+    }
+
+    names.push_back("empty");
+    patterns.emplace_back("");
+
+    names.push_back("capture");
+    patterns.emplace_back("00 [rel32] 48 [rel8]");
+
+    // Common bytes in long runs, which use Boyer-Moore with stored skip tables
+    names.push_back("zeros");
+    patterns.emplace_back("00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00");
+
+    names.push_back("masked zeros");
+    patterns.emplace_back("00 00 00 00 00 00 00 00 00 00 00 00 ? 00 00 00 00 00 00 00 00 00 00 00 00 00");
+
+    std::ostringstream output;
+    mem::signature_db::save(output, names, patterns);
+
+    const std::string compiled = output.str();
+
+    std::vector<uint64_t> buffer((compiled.size() + 7) / 8);
+    std::memcpy(buffer.data(), compiled.data(), compiled.size());
+
+    mem::signature_db db;
+
+    REQUIRE(!db.load(buffer.data(), compiled.size() - 1));
+    REQUIRE(!db.load(reinterpret_cast<const char*>(buffer.data()) + 1, compiled.size() - 1));
+    REQUIRE(db.size() == 0);
+
+    REQUIRE(db.load(buffer.data(), compiled.size()));
+    REQUIRE(db.size() == patterns.size());
+
+    mem::region range(data.data(), data.size());
+
+    size_t boyer_moore_count = 0;
+
+    for (size_t i = 0; i < patterns.size(); ++i)
+    {
+        const mem::pattern_view pattern = db.get_pattern(i);
+
+        REQUIRE(db.get_name(i) == names[i]);
+        REQUIRE(db.find(names[i].c_str()) == i);
+
+        REQUIRE(pattern.to_string() == patterns[i].to_string());
+        REQUIRE(pattern.trimmed_size() == patterns[i].trimmed_size());
+        REQUIRE(pattern.needs_masks() == patterns[i].needs_masks());
+        REQUIRE(pattern.capture_count() == patterns[i].captures().size());
+
+        const mem::auto_scanner expected(patterns[i]);
+        const mem::auto_scanner scanner = db.get_scanner(i);
+
+        REQUIRE(scanner.engine() == expected.engine());
+        REQUIRE(scanner.scan_all(range) == expected.scan_all(range));
+        REQUIRE(scanner.scan_last(range) == expected.scan_last(range));
+
+        if (scanner.engine() == mem::scan_engine::boyer_moore)
+            ++boyer_moore_count;
+    }
+
+    REQUIRE(boyer_moore_count != 0);
+    REQUIRE(db.find("missing") == SIZE_MAX);
+
+    // Skip tables which would stall or overshoot a scan, and anchors out of order, are rejected
+    bool corrupted_bc = false;
+    bool corrupted_gs = false;
+    bool corrupted_pair = false;
+    bool corrupted_capture = false;
+
+    for (size_t i = 0; i < patterns.size(); ++i)
+    {
+        uint32_t fields[14];
+        std::memcpy(fields, compiled.data() + 16 + (i * sizeof(fields)), sizeof(fields));
+
+        const uint32_t trimmed_size = fields[4];
+        const uint32_t bc_offset = fields[8];
+        const uint32_t gs_offset = fields[10];
+
+        if (gs_offset)
+        {
+            std::vector<uint64_t> copy = buffer;
+
+            const uint16_t stalled = 1;
+            std::memcpy(reinterpret_cast<char*>(copy.data()) + gs_offset, &stalled, sizeof(stalled));
+
+            REQUIRE(!db.load(copy.data(), compiled.size()));
+
+            corrupted_gs = true;
+        }
+
+        if (bc_offset && !(fields[5] & 0x4) && (trimmed_size < 0xFF))
+        {
+            std::vector<uint64_t> copy = buffer;
+
+            reinterpret_cast<char*>(copy.data())[bc_offset + 0x48] = static_cast<char>(trimmed_size + 1);
+
+            REQUIRE(!db.load(copy.data(), compiled.size()));
+
+            corrupted_bc = true;
+        }
+
+        if (!(fields[5] & 0x2) && (fields[7] != UINT32_MAX))
+        {
+            std::vector<uint64_t> copy = buffer;
+
+            std::swap(fields[6], fields[7]);
+            std::memcpy(reinterpret_cast<char*>(copy.data()) + 16 + (i * sizeof(fields)), fields, sizeof(fields));
+
+            REQUIRE(!db.load(copy.data(), compiled.size()));
+
+            corrupted_pair = true;
+        }
+
+        // resolve reads one byte for a size of 1 and four otherwise, so only those sizes are accepted
+        if (fields[12])
+        {
+            for (uint16_t size : {uint16_t(0), uint16_t(2)})
+            {
+                std::vector<uint64_t> copy = buffer;
+
+                std::memcpy(reinterpret_cast<char*>(copy.data()) + fields[11] + 4, &size, sizeof(size));
+
+                REQUIRE(!db.load(copy.data(), compiled.size()));
+            }
+
+            corrupted_capture = true;
+        }
+    }
+
+    REQUIRE(corrupted_bc);
+    REQUIRE(corrupted_gs);
+    REQUIRE(corrupted_pair);
+    REQUIRE(corrupted_capture);
+    REQUIRE(db.load(buffer.data(), compiled.size()));
+}
+
+TEST_CASE("mem::hasher64")
+{
+    std::vector<uint8_t> data(1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 131);
+
+    mem::hasher64 whole;
+    whole.update(data.data(), data.size());
+
+    for (size_t step : {size_t(1), size_t(3), size_t(7), size_t(8), size_t(9), size_t(64)})
+    {
+        mem::hasher64 split;
+
+        for (size_t i = 0; i < data.size(); i += step)
+            split.update(&data[i], std::min(step, data.size() - i));
+
+        REQUIRE(split.digest() == whole.digest());
+    }
+
+    mem::hasher64 shorter;
+    shorter.update(data.data(), data.size() - 1);
+
+    mem::hasher64 seeded(1);
+    seeded.update(data.data(), data.size());
+
+    REQUIRE(shorter.digest() != whole.digest());
+    REQUIRE(seeded.digest() != whole.digest());
+    REQUIRE(mem::hasher64().digest() != mem::hasher64(1).digest());
+}
+
+TEST_CASE("mem::pattern_cache")
+{
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+
+    const size_t offsets[] {0x100, 0x800, 0xF00};
+
+    for (size_t offset : offsets)
+    {
+        const uint8_t bytes[] {0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44};
+
+        std::memcpy(&data[offset], bytes, sizeof(bytes));
+    }
+
+    const mem::region range(data.data(), data.size());
+
+    const mem::pattern first("48 8B 05 11 22 33 44");
+    const mem::pattern second("48 8B 05 ? 22");
+    const mem::pattern missing("48 8B 05 11 22 33 55");
+
+    mem::pattern_cache cache(range);
+
+    REQUIRE(cache.scan_all(first).size() == 3);
+    REQUIRE(cache.scan_all(second).size() == 3);
+    REQUIRE(cache.scan_all(missing).empty());
+    REQUIRE(cache.scan(first, 1, 3) == &data[offsets[1]]);
+    REQUIRE(cache.scan(first) == nullptr);
+
+    std::ostringstream output;
+    cache.save(output);
+
+    const std::string saved = output.str();
+
+    {
+        mem::pattern_cache loaded(range);
+        std::istringstream input(saved);
+
+        REQUIRE(loaded.load(input));
+        REQUIRE(loaded.scan_all(first) == cache.scan_all(first));
+        REQUIRE(loaded.scan_all(second) == cache.scan_all(second));
+        REQUIRE(loaded.scan_all(missing).empty());
+    }
+
+    {
+        mem::pattern_cache loaded(range);
+        std::istringstream input(saved.substr(0, saved.size() - 1));
+
+        REQUIRE(!loaded.load(input));
+    }
+
+    {
+        mem::pattern_cache loaded(range);
+        std::istringstream input("PATD" + saved.substr(4));
+
+        REQUIRE(!loaded.load(input));
+    }
+
+    // Loaded results which no longer match are scanned again
+    data[offsets[0]] = 0x90;
+
+    {
+        mem::pattern_cache loaded(range);
+        std::istringstream input(saved);
+
+        REQUIRE(loaded.load(input));
+        REQUIRE(loaded.scan_all(first) == std::vector<mem::pointer> {&data[offsets[1]], &data[offsets[2]]});
+    }
+
+    // A cached result must leave room for the whole pattern
+    std::vector<uint8_t> small(64);
+
+    for (size_t i = 0; i < small.size(); ++i)
+        small[i] = static_cast<uint8_t>(i);
+
+    const mem::region small_range(small.data(), small.size());
+    const mem::pattern prefix(small.data(), nullptr, 32);
+
+    mem::pattern_cache small_cache(small_range);
+
+    REQUIRE(small_cache.scan_all(prefix).size() == 1);
+
+    std::ostringstream small_output;
+    small_cache.save(small_output);
+
+    std::string patched = small_output.str();
+
+    for (size_t offset : {size_t(63), size_t(33)})
+    {
+        std::memcpy(&patched[patched.size() - sizeof(size_t)], &offset, sizeof(offset));
+
+        mem::pattern_cache loaded(small_range);
+        std::istringstream input(patched);
+
+        REQUIRE(!loaded.load(input));
+    }
+
+    const size_t offset = 32;
+    std::memcpy(&patched[patched.size() - sizeof(size_t)], &offset, sizeof(offset));
+
+    mem::pattern_cache loaded(small_range);
+    std::istringstream input(patched);
+
+    REQUIRE(loaded.load(input));
+    REQUIRE(loaded.scan_all(prefix) == std::vector<mem::pointer> {small.data()});
+}
+
+TEST_CASE("mem::pattern_cache resolve")
+{
+    std::vector<uint8_t> data(mem::pattern_cache::resolve_chunk_size * 3);
+
+    uint32_t seed = 0xBADF00D;
+
+    for (uint8_t& value : data)
+    {
+        seed = (seed * 1103515245) + 12345;
+        value = static_cast<uint8_t>(seed >> 16);
+    }
+
+    const uint8_t bytes[] {0xE8, 0x11, 0x22, 0x33, 0x44, 0x48, 0x85, 0xC0, 0x75, 0x10};
+
+    // Matches across the chunk boundaries, and at the very end
+    for (size_t offset : {size_t(0), size_t(0x1234), mem::pattern_cache::resolve_chunk_size - 3,
+             (mem::pattern_cache::resolve_chunk_size * 2) - 9, data.size() - sizeof(bytes)})
+    {
+        std::memcpy(&data[offset], bytes, sizeof(bytes));
+    }
+
+    const mem::region range(data.data(), data.size());
+
+    const std::vector<mem::pattern> patterns {mem::pattern("E8 11 22 33 44 48 85 C0 75 10"),
+        mem::pattern("E8 ? ? ? ? 48 85 C0"), mem::pattern("48 85 C0 75"), mem::pattern("85 C0 75 10"),
+        mem::pattern("E8 11 22 33 44 48 85 C0 75 10"), mem::pattern("?1 ?2 ?3"), mem::pattern("")};
+
+    for (size_t thread_count : {size_t(1), size_t(4)})
+    {
+        mem::pattern_cache cache(range);
+
+        // A stale cached result is replaced
+        std::ostringstream output;
+        cache.scan_all(patterns[2]);
+        cache.save(output);
+
+        data[0x1234 + 5] = 0x90;
+
+        std::istringstream input(output.str());
+        REQUIRE(cache.load(input));
+
+        cache.resolve(patterns, thread_count);
+
+        for (const mem::pattern& pattern : patterns)
+            REQUIRE(cache.scan_all(pattern) == mem::default_scanner(pattern).scan_all(range));
+
+        REQUIRE(cache.scan_all(patterns[0]).size() == 4);
+
+        data[0x1234 + 5] = 0x48;
+    }
+}
+
+TEST_CASE("mem::pattern captures")
+{
+    const mem::pattern pattern("E8 [rel32] 48 8B ? [rel8+1] 00");
+
+    REQUIRE(pattern.size() == 10);
+    REQUIRE(pattern.to_string() == "E8 [rel32] 48 8B ? [rel8+1] 00");
+    REQUIRE(pattern.captures().size() == 2);
+    REQUIRE(pattern.captures()[0].offset == 1);
+    REQUIRE(pattern.captures()[0].size == 4);
+    REQUIRE(pattern.captures()[1].offset == 8);
+    REQUIRE(pattern.captures()[1].size == 1);
+    REQUIRE(pattern.captures()[1].trailing == 1);
+
+    for (const char* string : {"E8 [rel16]", "E8 [rel32", "E8 [rel32+]", "E8 [rel]", "E8 [abs32]", "E8 [rel320]"})
+        REQUIRE(!mem::pattern(string));
+
+    for (uint16_t size : {uint16_t(0), uint16_t(2), uint16_t(3)})
+    {
+        const mem::pattern_capture capture {1, size, 0};
+
+        REQUIRE(!mem::pattern("\xE8\x00\x00\x00\x00", nullptr, 5, &capture, 1));
+    }
+
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+
+    const size_t offsets[] {0x10, 0x333, 0x800, 0xFF0};
+    const int32_t displacements[] {0x100, -0x300, 0x7FFFFF, -0x10};
+    const int8_t short_displacements[] {5, -100, 0, -1};
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const uint8_t bytes[] {0xE8, 0, 0, 0, 0, 0x48, 0x8B, 0xAA, static_cast<uint8_t>(short_displacements[i]), 0x00};
+
+        std::memcpy(&data[offsets[i]], bytes, sizeof(bytes));
+        std::memcpy(&data[offsets[i] + 1], &displacements[i], 4);
+    }
+
+    // The last match ends at the end of the data
+    data.resize(offsets[3] + 10);
+
+    mem::region range(data.data(), data.size());
+
+    const mem::capture_results results = mem::default_scanner(pattern).scan_captures(range);
+
+    REQUIRE(results.stride == 2);
+    REQUIRE(results.addresses.size() == 4);
+    REQUIRE(results.targets.size() == 8);
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const mem::pointer address = data.data() + offsets[i];
+
+        REQUIRE(results.addresses[i] == address);
+        REQUIRE(results.targets[i * 2] == address.add(5).add(static_cast<size_t>(displacements[i])));
+        REQUIRE(results.targets[i * 2] == address.add(1).rip(4));
+        REQUIRE(results.targets[(i * 2) + 1] == address.add(10).add(static_cast<size_t>(short_displacements[i])));
+    }
+
+    const mem::capture_results resolved = mem::resolve_captures(pattern, results.addresses);
+
+    REQUIRE(resolved.targets == results.targets);
+    REQUIRE(mem::boyer_moore_scanner(pattern).scan_captures(range).targets == results.targets);
+
+    const mem::pattern copy(pattern);
+
+    REQUIRE(copy.to_string() == pattern.to_string());
+    REQUIRE(mem::resolve_captures(copy, results.addresses).targets == results.targets);
+}
+
+TEST_CASE("mem::hamming_scanner")
+{
+    std::vector<uint8_t> data(0x3000);
+
+    uint32_t seed = 0xC0FFEE;
+
+    for (uint8_t& value : data)
+    {
+        seed = (seed * 1103515245) + 12345;
+        value = static_cast<uint8_t>(seed >> 16);
+    }
+
+    const mem::pattern pattern("48 8B 05 ? ? ? ? 48 85 C0 74 ? 48 8B 40 10 C3");
+
+    const size_t offsets[] {0x100, 0x777, 0x1234, 0x2000, 0x3000 - 17};
+    const size_t mismatches[] {0, 1, 2, 3, 1};
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        uint8_t* code = &data[offsets[i]];
+
+        for (size_t j = 0; j < pattern.size(); ++j)
+            code[j] = static_cast<uint8_t>((code[j] & ~pattern.masks()[j]) | pattern.bytes()[j]);
+
+        // Break bytes from the end, so wildcards are never hit
+        for (size_t j = 0; j < mismatches[i]; ++j)
+            code[pattern.size() - 1 - (j * 2)] ^= 0x5A;
+    }
+
+    mem::region range(data.data(), data.size());
+
+    for (size_t limit = 0; limit < 5; ++limit)
+    {
+        const std::vector<mem::hamming_result> results = mem::hamming_scanner(pattern, limit).scan_all(range);
+
+        std::vector<mem::hamming_result> expected;
+
+        for (size_t i = 0; i + pattern.size() <= data.size(); ++i)
+        {
+            size_t count = 0;
+
+            for (size_t j = 0; j < pattern.size(); ++j)
+                count += (data[i + j] & pattern.masks()[j]) != (pattern.bytes()[j] & pattern.masks()[j]);
+
+            if (count <= limit)
+                expected.push_back({&data[i], count});
+        }
+
+        REQUIRE(results.size() == expected.size());
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            REQUIRE(results[i].address == expected[i].address);
+            REQUIRE(results[i].mismatches == expected[i].mismatches);
+        }
+
+        for (size_t i = 0; i < 5; ++i)
+        {
+            const bool found = std::any_of(results.begin(), results.end(), [&](const mem::hamming_result& result) {
+                return (result.address == &data[offsets[i]]) && (result.mismatches == mismatches[i]);
+            });
+
+            REQUIRE(found == (mismatches[i] <= limit));
+        }
+    }
+
+    REQUIRE(mem::hamming_scanner(pattern, 1000).max_mismatches() == mem::hamming_scanner::mismatch_limit);
+    REQUIRE(mem::hamming_scanner(pattern, 1000).scan_all(range).size() == data.size() - pattern.size() + 1);
+    REQUIRE(mem::hamming_scanner(mem::pattern(), 1).scan_all(range).empty());
+}
+
+TEST_CASE("mem::decode_x86_64")
+{
+    struct expected
+    {
+        std::vector<uint8_t> code;
+        size_t length;
+        size_t disp_offset;
+        size_t disp_size;
+        size_t imm_offset;
+        size_t imm_size;
+        bool rip_relative;
+        bool relative;
+    };
+
+    const expected tests[] {
+        {{0x48, 0x8B, 0x05, 1, 2, 3, 4}, 7, 3, 4, 7, 0, true, false},
+        {{0xE8, 1, 2, 3, 4}, 5, 1, 0, 1, 4, false, true},
+        {{0x48, 0x8D, 0x4C, 0x24, 0x20}, 5, 4, 1, 5, 0, false, false},
+        {{0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8}, 10, 2, 0, 2, 8, false, false},
+        {{0x66, 0xB8, 1, 2}, 4, 2, 0, 2, 2, false, false},
+        {{0x0F, 0x84, 1, 2, 3, 4}, 6, 2, 0, 2, 4, false, true},
+        {{0x74, 0x10}, 2, 1, 0, 1, 1, false, true},
+        {{0xF6, 0x05, 1, 2, 3, 4, 7}, 7, 2, 4, 6, 1, true, false},
+        {{0xF7, 0xD8}, 2, 2, 0, 2, 0, false, false},
+        {{0xC5, 0xF8, 0x77}, 3, 3, 0, 3, 0, false, false},
+        {{0xC4, 0xE3, 0x79, 0x0F, 0xC1, 0x08}, 6, 5, 0, 5, 1, false, false},
+        {{0x62, 0xF1, 0x7C, 0x48, 0x10, 0x44, 0x24, 0x01}, 8, 7, 1, 8, 0, false, false},
+        {{0xA1, 1, 2, 3, 4, 5, 6, 7, 8}, 9, 1, 0, 1, 8, false, false},
+        {{0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x08}, 6, 5, 0, 5, 1, false, false},
+        {{0xF3, 0x48, 0xAB}, 3, 3, 0, 3, 0, false, false},
+        {{0xC7, 0x44, 0x24, 0x08, 1, 2, 3, 4}, 8, 3, 1, 4, 4, false, false},
+    };
+
+    for (const expected& test : tests)
+    {
+        mem::x86_instruction insn;
+
+        REQUIRE(mem::decode_x86_64(test.code.data(), test.code.size(), insn));
+        REQUIRE(insn.length == test.length);
+        REQUIRE(insn.disp_offset == test.disp_offset);
+        REQUIRE(insn.disp_size == test.disp_size);
+        REQUIRE(insn.imm_offset == test.imm_offset);
+        REQUIRE(insn.imm_size == test.imm_size);
+        REQUIRE(insn.rip_relative == test.rip_relative);
+        REQUIRE(insn.relative == test.relative);
+
+        REQUIRE(!mem::decode_x86_64(test.code.data(), test.length - 1, insn));
+    }
+
+    mem::x86_instruction insn;
+
+    REQUIRE(!mem::decode_x86_64(reinterpret_cast<const uint8_t*>("\x06"), 1, insn));
+}
+
+TEST_CASE("mem::sig_maker")
+{
+    std::vector<uint8_t> data(0x10000);
+
+    uint32_t seed = 0x12345678;
+
+    for (uint8_t& value : data)
+    {
+        seed = (seed * 1103515245) + 12345;
+        value = static_cast<uint8_t>(seed >> 16);
+    }
+
+    // mov [rsp+8], rbx; mov rax, [rip+x]; call x; mov rcx, rax; mov edx, 0x10; call x; xor eax, eax
+    const uint8_t body[] {0x48, 0x89, 0x5C, 0x24, 0x08, 0x48, 0x8B, 0x05, 0, 0, 0, 0, 0xE8, 0, 0, 0, 0, 0x48,
+        0x8B, 0xC8, 0xBA, 0x10, 0x00, 0x00, 0x00, 0xE8, 0, 0, 0, 0, 0x33, 0xC0};
+
+    for (size_t i = 0; i < 64; ++i)
+    {
+        uint8_t* code = &data[0x100 + (i * 0x200)];
+
+        std::memcpy(code, body, sizeof(body));
+
+        for (size_t offset : {size_t(8), size_t(13), size_t(26)})
+            code[offset] = static_cast<uint8_t>(i * 11);
+
+        // The target is the only copy which adjusts the stack before returning
+        const uint8_t tail[] {0x48, 0x83, 0xC4, 0x28, 0xC3};
+
+        if (i == 40)
+            std::memcpy(code + sizeof(body), tail, sizeof(tail));
+        else
+            code[sizeof(body)] = 0xC3;
+    }
+
+    mem::region range(data.data(), data.size());
+    mem::pointer target = &data[0x100 + (40 * 0x200)];
+
+    const mem::sig_maker maker(range);
+    const mem::pattern pattern = maker.make(target);
+
+    REQUIRE(pattern);
+    REQUIRE(pattern.size() == sizeof(body) + 1);
+    REQUIRE(pattern.to_string().compare(0, 51, "48 89 5C 24 08 48 8B 05 ? ? ? ? E8 ? ? ? ? 48 8B C8") == 0);
+    REQUIRE(mem::default_scanner(pattern).scan_all(range) == std::vector<mem::pointer> {target});
+
+    REQUIRE(pattern.masks());
+
+    const mem::pattern shorter(pattern.bytes(), pattern.masks(), pattern.size() - 1);
+
+    REQUIRE(mem::default_scanner(shorter).scan_all(range).size() == 64);
+
+    REQUIRE(!maker.make(target, 16));
+    REQUIRE(!maker.make(data.data() + data.size()));
+
+    const mem::pointer random = &data[0x50];
+    const mem::pattern unique = maker.make(random);
+
+    REQUIRE(unique);
+    REQUIRE(unique.size() <= 16);
+    REQUIRE(mem::default_scanner(unique).scan_all(range) == std::vector<mem::pointer> {random});
+}
+
+TEST_CASE("mem::pattern scan")
+{
+    size_t page_size = mem::page_size();
+
+    size_t raw_size = page_size * (4 + 2); // 4 Pages + Guard Page Before/After
+    uint8_t* raw_data = static_cast<uint8_t*>(mem::protect_alloc(raw_size, mem::prot_flags::RW));
+
+    memset(raw_data, 0, raw_size);
+
+    mem::protect_modify(raw_data, page_size, mem::prot_flags::NONE);
+    mem::protect_modify(raw_data + raw_size - page_size, page_size, mem::prot_flags::NONE);
+
+    mem::region scan_region(raw_data + page_size, raw_size - (2 * page_size));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 05"), {
+        0x01, 0x02, 0x03, 0x04, 0x05
+    },{
+        0
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 ?"), {
+        0x01, 0x02, 0x03, 0x04, 0x05
+    },{
+        0
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 ?"), {
+        0x01, 0x02, 0x03, 0x04
+    },{
+
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 01 02 01"), {
+        0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01
+    }, {
+        0, 2, 4, 6
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern(""), {
+
+    }, {
+
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern(""), {
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+    }, {
+
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 ?2 3? 45"), {
+        0x02, 0x59, 0x72, 0x01, 0x01, 0x02, 0x34, 0x45, 0x59, 0x92
+    }, {
+        4
+    }));
+
+    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 ?2 3? 45"), {
+        0x02, 0x59, 0x72, 0x01, 0x01, 0x02, 0x43, 0x45, 0x59, 0x92
+    }, {
+
+    }));
+
+    mem::protect_free(raw_data, raw_size);
+}
+
+void check_simd_kernels(const mem::internal::simd_kernels& kernels)
+{
+    std::vector<mem::byte> data(300);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<mem::byte>(i % 37);
+
+    for (size_t start = 0; start < 70; ++start)
+    {
+        for (size_t length = 0; length + start + 5 <= data.size(); length += 7)
+        {
+            for (mem::byte value : {0, 5, 36, 37})
+            {
+                const mem::byte* expected = mem::internal::find_byte_memchr(&data[start], value, length);
+
+                REQUIRE(kernels.find_byte(&data[start], value, length) == expected);
+
+                expected = mem::internal::find_pair_generic(&data[start], value, 9, 4, length);
+
+                REQUIRE(kernels.find_pair(&data[start], value, 9, 4, length) == expected);
+
+                expected = mem::internal::rfind_byte_generic(&data[start], value, length);
+
+                REQUIRE(kernels.rfind_byte(&data[start], value, length) == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("mem::find_byte")
+{
+    CHECK_NOTHROW(check_simd_kernels(mem::internal::get_simd_kernels()));
+
+#if !defined(MEM_SIMD_SCANNER_USE_MEMCHR)
+    const mem::simd_level level = mem::get_simd_level();
+
+#    if defined(MEM_SIMD_SCANNER_HAS_SSE2)
+    if (level >= mem::simd_level::sse2)
+        CHECK_NOTHROW(check_simd_kernels(
+            {&mem::internal::find_byte_sse2, &mem::internal::find_pair_sse2, &mem::internal::rfind_byte_sse2}));
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX2)
+    if (level >= mem::simd_level::avx2)
+        CHECK_NOTHROW(check_simd_kernels(
+            {&mem::internal::find_byte_avx2, &mem::internal::find_pair_avx2, &mem::internal::rfind_byte_avx2}));
+#    endif
+
+#    if defined(MEM_SIMD_SCANNER_HAS_AVX512BW)
+    if (level >= mem::simd_level::avx512bw)
+        CHECK_NOTHROW(check_simd_kernels({&mem::internal::find_byte_avx512bw, &mem::internal::find_pair_avx512bw,
+            &mem::internal::rfind_byte_avx512bw}));
+#    endif
+#endif
+}
+
+void check_simd_scan(mem::region range, const char* string)
+{
+    mem::pattern pattern(string);
+
+    std::vector<mem::pointer> expected;
+
+    for (size_t i = 0; i + pattern.size() <= range.size; ++i)
+    {
+        if (pattern.match(range.start + i))
+            expected.push_back(range.start + i);
+    }
+
+    REQUIRE(!expected.empty());
+
+    REQUIRE(mem::simd_scanner(pattern).scan_all(range) == expected);
+    REQUIRE(mem::simd_scanner(pattern, mem::simd_scanner::default_frequencies(), false).scan_all(range) == expected);
+
+    mem::simd_scanner scanner(pattern);
+
+    // Each match is the last one in the range which ends with it
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        const size_t end = static_cast<size_t>(expected[i] - range.start) + pattern.size();
+
+        REQUIRE(scanner.scan_last(mem::region(range.start, end)) == expected[i]);
+        REQUIRE(scanner.scan_last(mem::region(range.start, end - 1)) == (i ? expected[i - 1] : nullptr));
+    }
+}
+
+TEST_CASE("mem::simd_scanner")
+{
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    CHECK_NOTHROW(check_simd_scan(range, "02 04 06"));
+    CHECK_NOTHROW(check_simd_scan(range, "02 ? 06 ? 05"));
+    CHECK_NOTHROW(check_simd_scan(range, "07 ?2 04 06 0? 05"));
+    CHECK_NOTHROW(check_simd_scan(range, "08 ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? ? 08"));
+    CHECK_NOTHROW(check_simd_scan(range, "0? 0?"));
+}
+
+TEST_CASE("mem::boyer_moore_scanner")
+{
+    std::vector<uint8_t> data(0x2000);
+
+    uint32_t state = 1;
+
+    auto next = [&state] {
+        state = (state * 1103515245) + 12345;
+
+        return state >> 16;
+    };
+
+    // A small alphabet, so masked patterns match in many places
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(0x40 + (next() % 6));
+
+    mem::region range(data.data(), data.size());
+
+    const mem::byte mask_choices[] {0xFF, 0xFF, 0xFF, 0x00, 0xF0, 0x0F};
+
+    for (size_t i = 0; i < 200; ++i)
+    {
+        // Include patterns long enough to need 16-bit skips
+        size_t length = (i % 10) ? (1 + (next() % 40)) : (250 + (next() % 100));
+        size_t offset = next() % (data.size() - length);
+
+        std::vector<mem::byte> masks(length);
+
+        for (mem::byte& mask : masks)
+            mask = mask_choices[next() % 6];
+
+        if (i % 20 == 0)
+            std::fill(masks.begin(), masks.end(), mem::byte(0xFF));
+
+        mem::pattern pattern(&data[offset], masks.data(), length);
+
+        // Patterns of only wildcards never match
+        if (!pattern.trimmed_size())
+            continue;
+
+        std::vector<mem::pointer> expected;
+
+        for (size_t j = 0; j + pattern.size() <= range.size; ++j)
+        {
+            if (pattern.match(range.start + j))
+                expected.push_back(range.start + j);
+        }
+
+        REQUIRE(mem::boyer_moore_scanner(pattern).scan_all(range) == expected);
+        REQUIRE(mem::boyer_moore_scanner(pattern, 1, 1).scan_all(range) == expected);
+        REQUIRE(mem::boyer_moore_scanner(pattern, 0, 0).scan_all(range) == expected);
+
+        // Scan backwards from a random point, as when searching back from a known address
+        const size_t end = next() % (data.size() + 1);
+
+        mem::pointer last = nullptr;
+
+        for (mem::pointer result : expected)
+        {
+            if (static_cast<size_t>(result - range.start) + pattern.size() <= end)
+                last = result;
+        }
+
+        mem::region head(range.start, end);
+
+        REQUIRE(mem::boyer_moore_scanner(pattern).scan_last(range) == expected.back());
+        REQUIRE(mem::boyer_moore_scanner(pattern).scan_last(head) == last);
+        REQUIRE(mem::boyer_moore_scanner(pattern, 1, 1).scan_last(head) == last);
+        REQUIRE(mem::boyer_moore_scanner(pattern, 0, 0).scan_last(head) == last);
+
+        // The reverse table is built by the first rscan, so copies taken before and after it must agree
+        mem::boyer_moore_scanner scanner(pattern, 1, 1);
+        mem::boyer_moore_scanner before = scanner;
+
+        REQUIRE(scanner.scan_last(head) == last);
+
+        const void* const rbc_skips = scanner.get_tables().rbc_skips;
+        mem::boyer_moore_scanner after = scanner;
+
+        REQUIRE(before.scan_last(head) == last);
+        REQUIRE(after.scan_last(head) == last);
+        REQUIRE(after.get_tables().rbc_skips == rbc_skips);
+
+        // Scanners made from precomputed tables, such as those of a signature_db, use them in place
+        const mem::boyer_moore_scanner::tables tables = after.get_tables();
+        const mem::boyer_moore_scanner aliased(pattern, tables);
+
+        REQUIRE(aliased.get_tables().bc_skips == tables.bc_skips);
+        REQUIRE(aliased.get_tables().rbc_skips == tables.rbc_skips);
+        REQUIRE(aliased.scan_all(range) == expected);
+        REQUIRE(aliased.scan_last(head) == last);
+
+        // Threads racing to build the table of one scanner all use the same one
+        if (i % 10 == 0)
+        {
+            const mem::boyer_moore_scanner shared(pattern, 1, 1);
+
+            std::vector<mem::pointer> results(4);
+            std::vector<std::thread> threads;
+
+            for (size_t j = 0; j < results.size(); ++j)
+                threads.emplace_back([&shared, &results, head, j] { results[j] = shared.scan_last(head); });
+
+            for (std::thread& thread : threads)
+                thread.join();
+
+            for (mem::pointer result : results)
+                REQUIRE(result == last);
+        }
+    }
+}
+
+template <typename Scanner>
+void check_scan_results(const Scanner& scanner, mem::region range, const mem::pattern& pattern)
+{
+    std::vector<mem::pointer> expected;
+
+    for (size_t i = 0; i + pattern.size() <= range.size; ++i)
+    {
+        if (pattern.match(range.start + i))
+            expected.push_back(range.start + i);
+    }
+
+    // Enough matches to need more than one batch of the iterator
+    REQUIRE(expected.size() > 32);
+    REQUIRE(scanner.scan_all(range) == expected);
+
+    std::vector<mem::pointer> results;
+
+    for (mem::pointer result : scanner.matches(range))
+        results.push_back(result);
+
+    REQUIRE(results == expected);
+    REQUIRE(scanner.count(range) == expected.size());
+
+    size_t seen = 0;
+
+    REQUIRE(scanner(range, [&seen](mem::pointer) { return ++seen == 20; }) == expected[19]);
+
+    REQUIRE(scanner.first_n(range, 0).empty());
+    REQUIRE(scanner.first_n(range, 1) == std::vector<mem::pointer>(expected.begin(), expected.begin() + 1));
+    REQUIRE(scanner.first_n(range, expected.size() + 1) == expected);
+
+    std::vector<mem::pointer> buffer(expected.size());
+
+    REQUIRE(scanner.scan_all(range, buffer.begin()) == buffer.end());
+    REQUIRE(buffer == expected);
+
+    REQUIRE(scanner.scan_last(range) == expected.back());
+}
+
+TEST_CASE("mem::scanner_base")
+{
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    const char* const patterns[] {"02 04 06", "03 05 07 ? 0?", "00 02 04 06 08 05 07 02 04 06 03 05 07 09 04 01 03 05 07 09"};
+
+    for (const char* string : patterns)
+    {
+        mem::pattern pattern(string);
+
+        CHECK_NOTHROW(check_scan_results(mem::simd_scanner(pattern), range, pattern));
+        CHECK_NOTHROW(check_scan_results(mem::boyer_moore_scanner(pattern), range, pattern));
+        CHECK_NOTHROW(check_scan_results(mem::boyer_moore_scanner(pattern, 1, 1), range, pattern));
+        CHECK_NOTHROW(check_scan_results(mem::auto_scanner(pattern), range, pattern));
+    }
+
+    // Overlapping matches, including through the good suffix skips
+    std::vector<uint8_t> zeros(0x100);
+    mem::region zero_range(zeros.data(), zeros.size());
+    mem::pattern run("00 00 00 00");
+
+    CHECK_NOTHROW(check_scan_results(mem::simd_scanner(run), zero_range, run));
+    CHECK_NOTHROW(check_scan_results(mem::boyer_moore_scanner(run, 1, 1), zero_range, run));
+
+    mem::pattern missing("FF FF");
+    mem::simd_scanner scanner(missing);
+
+    REQUIRE(scanner.matches(range).begin() == scanner.matches(range).end());
+    REQUIRE(scanner.count(range) == 0);
+}
+
+TEST_CASE("mem::auto_scanner")
+{
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    const char* const patterns[] {"02 04 06", "03 05 07 ? 0?", "00 02 04 06 08", "?0 ?2 0?", "00 00 00 00", "00 00 00 ?"};
+
+    for (const char* string : patterns)
+    {
+        mem::pattern pattern(string);
+
+        REQUIRE(mem::auto_scanner(pattern).scan_all(range) == mem::simd_scanner(pattern).scan_all(range));
+    }
+
+    REQUIRE(mem::auto_scanner(mem::pattern("48 8B 05 ? ? ? ?")).engine() == mem::scan_engine::simd);
+    REQUIRE(mem::auto_scanner(mem::pattern("00 00 00 ? 00")).engine() == mem::scan_engine::simd);
+    REQUIRE(mem::auto_scanner(mem::pattern("00 00 00 00 ? 00")).engine() == mem::scan_engine::boyer_moore);
+    REQUIRE(mem::auto_scanner(mem::pattern("?0 ?2 0?")).engine() == mem::scan_engine::boyer_moore);
+}
+
+TEST_CASE("mem::frequency_table")
+{
+    std::vector<uint8_t> data;
+
+    for (size_t i = 0; i < 256; ++i)
+        data.insert(data.end(), i + 1, static_cast<uint8_t>(i ^ 0x5A));
+
+    std::uint64_t counts[256] {};
+
+    mem::count_bytes({data.data(), data.size()}, counts);
+
+    for (size_t i = 0; i < 256; ++i)
+        REQUIRE(counts[i ^ 0x5A] == i + 1);
+
+    mem::frequency_table table({data.data(), data.size()});
+
+    for (size_t i = 0; i < 256; ++i)
+        REQUIRE(table[static_cast<mem::byte>(i ^ 0x5A)] == i);
+
+    REQUIRE(mem::pattern("5A A5").get_skip_pos(table.data()) == 0);
+
+    mem::module self = mem::module::self();
+
+    const mem::byte* frequencies = mem::module_frequencies(self);
+
+    REQUIRE(frequencies == mem::module_frequencies(self));
+    REQUIRE(frequencies[0x00] == 0xFF);
+
+    // A module of a different size at the same base is counted again, without freeing the first table
+    const mem::byte* resized = mem::module_frequencies(mem::module(self.start, self.size - 1));
+
+    REQUIRE(resized != frequencies);
+    REQUIRE(frequencies[0x00] == 0xFF);
+}
+
+TEST_CASE("mem::multi_scanner")
+{
+    std::vector<uint8_t> data(0x10000);
+
+    uint32_t seed = 0x12345678;
+
+    for (auto& value : data)
+    {
+        seed = (seed * 1103515245) + 12345;
+        value = static_cast<uint8_t>(seed >> 16) & 0x1F;
+    }
+
+    const char* const planted[] {
+        "01 02 03 04 05",
+        "01 ? 03 ? 05",
+        "1? 2? 3?",
+        "?1 ?2",
+        "4? ? 41 42",
+        "0A 0B 0C",
+        "0A 0B 0C ? ?",
+    };
+
+    for (size_t i = 0; i < 64; ++i)
+    {
+        mem::pattern pattern(planted[i % 7]);
+
+        size_t offset = (i * 0x3FB) % (data.size() - pattern.size());
+
+        for (size_t j = 0; j < pattern.size(); ++j)
+            data[offset + j] = static_cast<uint8_t>((data[offset + j] & ~pattern.masks()[j]) | pattern.bytes()[j]);
+    }
+
+    std::vector<mem::pattern> patterns;
+
+    for (const char* pattern : planted)
+        patterns.emplace_back(pattern);
+
+    patterns.emplace_back("");
+    patterns.emplace_back("? ?");
+
+    mem::region range(data.data(), data.size());
+
+    std::vector<mem::multi_result> expected;
+
+    for (size_t i = 0; i < patterns.size(); ++i)
+    {
+        for (mem::pointer result : mem::default_scanner(patterns[i]).scan_all(range))
+            expected.push_back({i, result});
+    }
+
+    std::sort(expected.begin(), expected.end(), [](const mem::multi_result& lhs, const mem::multi_result& rhs) {
+        return (lhs.address < rhs.address) || ((lhs.address == rhs.address) && (lhs.index < rhs.index));
+    });
+
+    REQUIRE(expected.size() >= 64);
+
+    std::vector<mem::multi_result> results = mem::multi_scanner(patterns).scan_all(range);
+
+    REQUIRE(results.size() == expected.size());
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        REQUIRE(results[i].index == expected[i].index);
+        REQUIRE(results[i].address == expected[i].address);
+    }
 }
 
-void check_pattern_results(mem::region whole_region, const mem::pattern& pattern, const std::vector<uint8_t>& scan_data, const std::unordered_set<size_t>& offsets)
+template <typename Scanner>
+void check_parallel_scan(mem::region range, const mem::pattern& pattern, size_t chunk_size)
 {
-    REQUIRE(scan_data.size() <= whole_region.size);
+    std::vector<mem::pointer> expected = Scanner(pattern).scan_all(range);
+    std::vector<mem::pointer> results = mem::parallel_scanner<Scanner>(pattern, 4, chunk_size).scan_all(range);
 
-    mem::region scan_region = whole_region.sub_region(whole_region.start.add(whole_region.size - scan_data.size()));
+    REQUIRE(!expected.empty());
+    REQUIRE(results == expected);
+}
 
-    REQUIRE(scan_region.start == whole_region.start.add(whole_region.size - scan_data.size()));
-    REQUIRE(scan_region.size == scan_data.size());
+TEST_CASE("mem::parallel_scanner")
+{
+    std::vector<uint8_t> data(0x4000);
 
-    scan_region.copy(scan_data.data());
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
 
-    mem::default_scanner scanner(pattern);
+    mem::region range(data.data(), data.size());
 
-    auto scan_results = scanner.scan_all(whole_region);
+    const size_t chunk_sizes[] {1, 3, 16, 100, 0x1000};
 
-    REQUIRE(scan_results.size() == offsets.size());
+    for (size_t chunk_size : chunk_sizes)
+    {
+        CHECK_NOTHROW(check_parallel_scan<mem::simd_scanner>(range, mem::pattern("02 04 06"), chunk_size));
+        CHECK_NOTHROW(check_parallel_scan<mem::simd_scanner>(range, mem::pattern("03 05 07 ? 0?"), chunk_size));
+        CHECK_NOTHROW(check_parallel_scan<mem::boyer_moore_scanner>(range, mem::pattern("00 02 04 06 08 05 07 02 04 06 03"), chunk_size));
+        CHECK_NOTHROW(check_parallel_scan<mem::boyer_moore_scanner>(range, mem::pattern("05 ?7 0?"), chunk_size));
+    }
 
-    std::unordered_set<size_t> scan_results_set;
+    // An exception on the calling thread waits for the others to finish, rather than destroying them
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> failed {false};
 
-    for (auto result : scan_results)
+    REQUIRE_THROWS_AS(mem::internal::scan_in_chunks<mem::pointer>(range, 16, 0, 4,
+                          [caller, &failed](mem::region, mem::pointer, std::vector<mem::pointer>&) {
+                              if (std::this_thread::get_id() == caller)
+                              {
+                                  failed = true;
+
+                                  throw std::runtime_error("Chunk failed");
+                              }
+
+                              // Hold each chunk until the caller has claimed one
+                              while (!failed)
+                                  std::this_thread::yield();
+                          }),
+        std::runtime_error);
+}
+
+TEST_CASE("mem::signature_set")
+{
+    std::vector<uint8_t> data(0x8000);
+
+    uint32_t seed = 0x12345678;
+
+    auto next = [&seed] {
+        seed = (seed * 1103515245) + 12345;
+
+        return seed >> 16;
+    };
+
+    for (auto& value : data)
+        value = static_cast<uint8_t>(next() & 0x1F);
+
+    std::vector<mem::pattern> patterns;
+
+    const mem::byte mask_choices[] {0xFF, 0xFF, 0xFF, 0x00, 0xF0, 0x0F};
+
+    size_t total_size = 0;
+
+    // Groups of patterns taken from the same offset share prefixes of different lengths
+    for (size_t i = 0; i < 40; ++i)
     {
-        scan_results_set.emplace(result - scan_region.start);
+        const size_t offset = next() % (data.size() - 32);
+
+        std::vector<mem::byte> masks(32);
+
+        for (mem::byte& mask : masks)
+            mask = mask_choices[next() % 6];
+
+        for (size_t j = 0; j < 5; ++j)
+        {
+            const size_t length = 2 + (next() % 30);
+
+            patterns.emplace_back(&data[offset], masks.data(), length);
+
+            total_size += patterns.back().trimmed_size();
+        }
     }
 
-    REQUIRE(scan_results_set.size() == offsets.size());
+    patterns.emplace_back("");
+    patterns.emplace_back("? ?");
+    patterns.emplace_back("1F");
+    patterns.emplace_back("?1 ?");
 
-    for (auto expected : offsets)
+    mem::region range(data.data(), data.size());
+
+    std::vector<mem::multi_result> expected;
+
+    for (size_t i = 0; i < patterns.size(); ++i)
     {
-        REQUIRE(scan_results_set.find(expected) != scan_results_set.end());
+        for (mem::pointer result : mem::default_scanner(patterns[i]).scan_all(range))
+            expected.push_back({i, result});
+    }
+
+    std::sort(expected.begin(), expected.end(), [](const mem::multi_result& lhs, const mem::multi_result& rhs) {
+        return (lhs.address < rhs.address) || ((lhs.address == rhs.address) && (lhs.index < rhs.index));
+    });
+
+    mem::signature_set set(patterns);
+
+    REQUIRE(set.node_count() < total_size);
+
+    std::vector<mem::multi_result> results = set.scan_all(range);
+
+    REQUIRE(results.size() == expected.size());
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        REQUIRE(results[i].index == expected[i].index);
+        REQUIRE(results[i].address == expected[i].address);
     }
 }
 
-TEST_CASE("mem::pattern scan")
+template <typename Scanner>
+void check_stream_scan(mem::region range, const mem::pattern& pattern, size_t chunk_size)
+{
+    std::vector<uint64_t> expected;
+
+    for (mem::pointer result : Scanner(pattern).scan_all(range))
+        expected.push_back(static_cast<uint64_t>(result - range.start));
+
+    REQUIRE(!expected.empty());
+
+    mem::stream_scanner<Scanner> scanner(pattern);
+    std::vector<uint64_t> results;
+
+    // Vary the chunk sizes to cover chunks smaller than the carried tail
+    for (size_t i = 0, j = 0; i < range.size; ++j)
+    {
+        size_t size = std::min<size_t>(chunk_size + (j % 3), range.size - i);
+
+        std::vector<uint8_t> chunk(range.start.add(i).as<const uint8_t*>(), range.start.add(i + size).as<const uint8_t*>());
+
+        for (uint64_t result : scanner.feed_all({chunk.data(), chunk.size()}))
+            results.push_back(result);
+
+        i += size;
+    }
+
+    REQUIRE(scanner.offset() == range.size);
+    REQUIRE(results == expected);
+}
+
+TEST_CASE("mem::stream_scanner")
+{
+    std::vector<uint8_t> data(0x2000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    const size_t chunk_sizes[] {1, 2, 7, 100, 0x1000};
+
+    for (size_t chunk_size : chunk_sizes)
+    {
+        CHECK_NOTHROW(check_stream_scan<mem::simd_scanner>(range, mem::pattern("02 04 06"), chunk_size));
+        CHECK_NOTHROW(check_stream_scan<mem::simd_scanner>(range, mem::pattern("03 05 07 ? 0?"), chunk_size));
+        CHECK_NOTHROW(check_stream_scan<mem::boyer_moore_scanner>(range, mem::pattern("00 02 04 06 08 05 07 02 04 06 03"), chunk_size));
+    }
+
+    mem::pattern pattern("02 04 06");
+    mem::stream_scanner<> scanner(pattern);
+
+    size_t count = 0;
+
+    REQUIRE(scanner.feed(range, [&count](uint64_t) { return ++count == 2; }));
+    REQUIRE(count == 2);
+    REQUIRE(scanner.offset() == range.size);
+
+    scanner.reset();
+
+    REQUIRE(scanner.offset() == 0);
+}
+
+TEST_CASE("mem::pattern match")
 {
     size_t page_size = mem::page_size();
 
-    size_t raw_size = page_size * (4 + 2); // 4 Pages + Guard Page Before/After
-    uint8_t* raw_data = static_cast<uint8_t*>(mem::protect_alloc(raw_size, mem::prot_flags::RW));
+    uint8_t* raw_data = static_cast<uint8_t*>(mem::protect_alloc(page_size * 2, mem::prot_flags::RW));
 
-    memset(raw_data, 0, raw_size);
+    mem::protect_modify(raw_data + page_size, page_size, mem::prot_flags::NONE);
 
-    mem::protect_modify(raw_data, page_size, mem::prot_flags::NONE);
-    mem::protect_modify(raw_data + raw_size - page_size, page_size, mem::prot_flags::NONE);
+    for (size_t size = 1; size <= 40; ++size)
+    {
+        // Place the data right before the guard page
+        uint8_t* data = raw_data + page_size - size;
 
-    mem::region scan_region(raw_data + page_size, raw_size - (2 * page_size));
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<uint8_t>(0x30 + i);
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 05"), {
-        0x01, 0x02, 0x03, 0x04, 0x05
-    },{
-        0
-    }));
+        std::vector<mem::byte> masks(size, 0xFF);
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 ?"), {
-        0x01, 0x02, 0x03, 0x04, 0x05
-    },{
-        0
-    }));
+        mem::pattern solid(data, masks.data(), size);
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 03 04 ?"), {
-        0x01, 0x02, 0x03, 0x04
-    },{
+        masks[size / 2] = 0xF0;
 
-    }));
+        mem::pattern masked(data, masks.data(), size);
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 02 01 02 01"), {
-        0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x01
-    }, {
-        0, 2, 4, 6
-    }));
+        REQUIRE(solid.match(data));
+        REQUIRE(masked.match(data));
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern(""), {
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] ^= 0x01;
 
-    }, {
+            REQUIRE(!solid.match(data));
+            REQUIRE(masked.match(data) == (i == size / 2));
 
-    }));
+            data[i] ^= 0x01;
+        }
+    }
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern(""), {
-        0x01, 0x02, 0x03, 0x04, 0x05, 0x06
-    }, {
+    mem::protect_free(raw_data, page_size * 2);
+}
 
-    }));
+template <size_t N>
+void check_static_pattern(const mem::static_pattern<N>& static_pattern, const char* string)
+{
+    mem::pattern pattern(string);
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 ?2 3? 45"), {
-        0x02, 0x59, 0x72, 0x01, 0x01, 0x02, 0x34, 0x45, 0x59, 0x92
-    }, {
-        4
-    }));
+    REQUIRE(static_pattern.size() == pattern.size());
+    REQUIRE(static_pattern.trimmed_size() == pattern.trimmed_size());
+    REQUIRE(static_pattern.needs_masks() == pattern.needs_masks());
 
-    CHECK_NOTHROW(check_pattern_results(scan_region, mem::pattern("01 ?2 3? 45"), {
-        0x02, 0x59, 0x72, 0x01, 0x01, 0x02, 0x43, 0x45, 0x59, 0x92
-    }, {
+    REQUIRE(memcmp(static_pattern.bytes(), pattern.bytes(), pattern.size()) == 0);
+    REQUIRE(memcmp(static_pattern.masks(), pattern.masks(), pattern.size()) == 0);
 
-    }));
+    std::vector<uint8_t> data(0x1000);
 
-    mem::protect_free(raw_data, raw_size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    mem::static_scanner<N> scanner(static_pattern);
+    std::vector<mem::pointer> expected = mem::simd_scanner(pattern).scan_all(range);
+
+    REQUIRE(scanner.scan_all(range) == expected);
+
+    std::vector<mem::pointer> results;
+
+    for (mem::pointer result : scanner.matches(range))
+        results.push_back(result);
+
+    REQUIRE(results == expected);
+    REQUIRE(scanner.count(range) == expected.size());
+}
+
+TEST_CASE("mem::static_pattern")
+{
+    static constexpr auto pattern = MEM_STATIC_PATTERN("01 ?2 ? 04&F0 05#3 ?? ?");
+
+    static_assert(pattern.size() == 9, "Invalid size");
+    static_assert(pattern.trimmed_size() == 7, "Invalid trimmed size");
+    static_assert(pattern.needs_masks(), "Invalid masks");
+    static_assert(pattern.bytes()[1] == 0x02 && pattern.masks()[1] == 0x0F, "Invalid nibble");
+    static_assert(pattern.bytes()[3] == 0x00 && pattern.masks()[3] == 0xF0, "Invalid mask");
+
+    CHECK_NOTHROW(check_static_pattern(pattern, "01 ?2 ? 04&F0 05#3 ?? ?"));
+    CHECK_NOTHROW(check_static_pattern(MEM_STATIC_PATTERN("02 04 06"), "02 04 06"));
+    CHECK_NOTHROW(check_static_pattern(MEM_STATIC_PATTERN("03 05 07 ? 0?"), "03 05 07 ? 0?"));
+    CHECK_NOTHROW(check_static_pattern(MEM_STATIC_PATTERN("00 02 04 06 08 05 07 02 04 06 03 05 07 09 06 01 03 05"), "00 02 04 06 08 05 07 02 04 06 03 05 07 09 06 01 03 05"));
+    CHECK_NOTHROW(check_static_pattern(MEM_STATIC_PATTERN("? ?"), "? ?"));
+    CHECK_NOTHROW(check_static_pattern(MEM_STATIC_PATTERN("?#3 01 00#40 ?2&3F 7F#2 ? ?#20 FF"), "?#3 01 00#40 ?2&3F 7F#2 ? ?#20 FF"));
+
+    CHECK_THROWS(mem::static_pattern<2>("01 02 03"));
+    CHECK_THROWS(mem::static_pattern<1>("0G"));
+}
+
+void check_extended_scan(mem::region range, const char* string, const std::vector<std::string>& expansions)
+{
+    mem::extended_pattern pattern(string);
+
+    REQUIRE(pattern);
+
+    std::vector<mem::pattern> patterns;
+
+    for (const std::string& expansion : expansions)
+        patterns.emplace_back(expansion.c_str());
+
+    std::vector<mem::pointer> expected;
+
+    for (size_t i = 0; i < range.size; ++i)
+    {
+        for (const mem::pattern& expansion : patterns)
+        {
+            if ((expansion.size() <= range.size - i) && expansion.match(range.start + i))
+            {
+                expected.push_back(range.start + i);
+
+                break;
+            }
+        }
+    }
+
+    REQUIRE(!expected.empty());
+
+    mem::extended_scanner scanner(pattern);
+
+    REQUIRE(scanner.scan_all(range) == expected);
+    REQUIRE(scanner.scan_last(range) == expected.back());
+}
+
+TEST_CASE("mem::extended_pattern")
+{
+    std::vector<uint8_t> data(0x1000);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>((i % 7) + (i % 5));
+
+    mem::region range(data.data(), data.size());
+
+    CHECK_NOTHROW(check_extended_scan(range, "(02|03) 04 [05-06]", {"02 04 05", "02 04 06", "03 04 05", "03 04 06"}));
+    CHECK_NOTHROW(check_extended_scan(range, "02 {1-3} 06", {"02 ? 06", "02 ? ? 06", "02 ? ? ? 06"}));
+    CHECK_NOTHROW(check_extended_scan(range, "[03-09] 0A", {"03 0A", "04 0A", "05 0A", "06 0A", "07 0A", "08 0A", "09 0A"}));
+    CHECK_NOTHROW(check_extended_scan(range, "((02|03) 04|05) 07", {"02 04 07", "03 04 07", "05 07"}));
+    CHECK_NOTHROW(check_extended_scan(range, "{1-2} 04 06", {"? 04 06", "? ? 04 06"}));
+    CHECK_NOTHROW(check_extended_scan(range, "06 (|08) 0A", {"06 0A", "06 08 0A"}));
+
+    std::vector<std::string> expansions;
+
+    for (const char* head : {"01 03", "02"})
+    {
+        for (const char* gap : {"", "? ", "? ? "})
+        {
+            for (const char* tail : {"05", "06 07"})
+                expansions.push_back(std::string(head) + " " + gap + tail);
+        }
+    }
+
+    CHECK_NOTHROW(check_extended_scan(range, "(01 03|02) {0-2} (05|06 07)", expansions));
+
+    mem::extended_pattern pattern("(01 03|02) {0-2} (05|06 07)");
+
+    REQUIRE(pattern.min_size() == 2);
+    REQUIRE(pattern.max_size() == 6);
+
+    // The alternatives and range are merged into a single masked prefix
+    mem::extended_pattern merged("(02|03) 04 [05-06] {2-3} 01");
+
+    REQUIRE(merged.prefix().size() == 3);
+    REQUIRE(merged.prefix().masks()[0] == 0xFE);
+    REQUIRE(merged.prefix().masks()[2] == 0xFC);
+
+    // Brackets are always byte ranges and braces always gaps, whatever the number of digits
+    mem::extended_pattern wide_gap("01 {10-20} 02");
+
+    REQUIRE(wide_gap.min_size() == 12);
+    REQUIRE(wide_gap.max_size() == 22);
+
+    mem::extended_pattern byte_range("01 [10-20] 02");
+
+    REQUIRE(byte_range.min_size() == 3);
+    REQUIRE(byte_range.max_size() == 3);
+
+    const char* const invalid_patterns[] {"", "(02|03", "02 )", "02 | 03", "[5-2]", "[09-02]", "[G]", "[]", "[1-]", "0G",
+        "{5-2}", "{0A}", "{}", "{1-}", "[1-3]", "[010-20]", "[05]", "{1-3]", "[05-06}"};
+
+    for (const char* invalid : invalid_patterns)
+        REQUIRE(!mem::extended_pattern(invalid));
 }
 
 TEST_CASE("mem::region contains")
@@ -262,7 +1816,7 @@ void check_unescape_string(const char* string, const void* data, size_t length,
     std::vector<mem::byte> unescaped = mem::unescape(string, strlen(string), strict);
 
     REQUIRE(unescaped.size() == length);
-    REQUIRE(memcmp(unescaped.data(), data, length) == 0);
+    REQUIRE(((length == 0) || (memcmp(unescaped.data(), data, length) == 0)));
 }
 
 #if defined(_MSC_VER)
@@ -312,3 +1866,160 @@ TEST_CASE("mem::prot_flags")
     CHECK_NOTHROW(check_prot_flags_roundtrip(mem::prot_flags::RX));
     CHECK_NOTHROW(check_prot_flags_roundtrip(mem::prot_flags::RWX));
 }
+
+#if defined(__unix__)
+TEST_CASE("mem::file_module")
+{
+    mem::file_module file("/proc/self/exe");
+
+    REQUIRE(file);
+
+    mem::module self = mem::module::self();
+
+    size_t exec_count = 0;
+
+    file.enum_segments([&](mem::region range, mem::prot_flags prot) {
+        REQUIRE(file.contains(range));
+
+        if (!(prot & mem::prot_flags::X) || (range.size < 64))
+            return false;
+
+        ++exec_count;
+
+        // Code is not relocated, so the file bytes match the loaded image
+        mem::pointer address = range.start.add(range.size / 2);
+        std::uintptr_t vaddr = file.to_vaddr(address);
+
+        REQUIRE(file.from_vaddr(vaddr) == address);
+        REQUIRE(memcmp(self.start.add(vaddr).as<const void*>(), address.as<const void*>(), 32) == 0);
+
+        std::vector<mem::byte> masks(32, 0xFF);
+        mem::pattern pattern(address.as<const void*>(), masks.data(), masks.size());
+        std::vector<mem::pointer> results = mem::simd_scanner(pattern).scan_all(range);
+
+        REQUIRE(std::find(results.begin(), results.end(), address) != results.end());
+
+        return false;
+    });
+
+    REQUIRE(exec_count != 0);
+
+    bool found_text = false;
+
+    file.enum_sections([&](const char* name, mem::region range) {
+        if (name && !strcmp(name, ".text"))
+        {
+            found_text = true;
+
+            REQUIRE(file.contains(range));
+        }
+
+        return found_text;
+    });
+
+    REQUIRE(found_text);
+
+    mem::file_module moved(std::move(file));
+
+    REQUIRE(moved);
+    REQUIRE(!file);
+
+    REQUIRE(!mem::file_module("/nonexistent/file"));
+}
+
+static std::string write_temp_file(const std::vector<char>& data)
+{
+    char path[] = "/tmp/mem_tests_XXXXXX";
+
+    int fd = mkstemp(path);
+
+    REQUIRE(fd != -1);
+    REQUIRE(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+
+    close(fd);
+
+    return path;
+}
+
+TEST_CASE("mem::file_module corrupt headers")
+{
+    std::vector<char> data;
+
+    {
+        mem::file_module file("/proc/self/exe");
+
+        REQUIRE(file);
+
+        data.assign(file.start.as<const char*>(), file.start.add(file.size).as<const char*>());
+    }
+
+    const ElfW(Ehdr)& ehdr = *reinterpret_cast<const ElfW(Ehdr)*>(data.data());
+
+    // Sizes which wrap around when added to the offset
+    std::vector<char> wrapped = data;
+
+    ElfW(Phdr)* phdrs = reinterpret_cast<ElfW(Phdr)*>(&wrapped[ehdr.e_phoff]);
+    ElfW(Shdr)* shdrs = reinterpret_cast<ElfW(Shdr)*>(&wrapped[ehdr.e_shoff]);
+
+    std::uintptr_t vaddr = 0;
+
+    for (size_t i = 0; i < ehdr.e_phnum; ++i)
+    {
+        if ((phdrs[i].p_type == PT_LOAD) && phdrs[i].p_offset)
+        {
+            phdrs[i].p_filesz = static_cast<decltype(phdrs[i].p_filesz)>(-0x80);
+            vaddr = phdrs[i].p_vaddr;
+        }
+    }
+
+    for (size_t i = 0; i < ehdr.e_shnum; ++i)
+    {
+        if (shdrs[i].sh_offset)
+            shdrs[i].sh_size = static_cast<decltype(shdrs[i].sh_size)>(-0x80);
+    }
+
+    {
+        const std::string path = write_temp_file(wrapped);
+
+        mem::file_module file(path.c_str());
+
+        unlink(path.c_str());
+
+        REQUIRE(file);
+        REQUIRE(vaddr != 0);
+        REQUIRE(file.from_vaddr(vaddr) == nullptr);
+
+        file.enum_segments([&](mem::region range, mem::prot_flags) {
+            REQUIRE(file.contains(range));
+            REQUIRE(range.size < file.size);
+
+            return false;
+        });
+
+        size_t section_count = 0;
+
+        file.enum_sections([&](const char*, mem::region) {
+            ++section_count;
+
+            return false;
+        });
+
+        REQUIRE(section_count == 0);
+    }
+
+    // Headers for a different word size or byte order
+    for (int index : {EI_CLASS, EI_DATA})
+    {
+        std::vector<char> foreign = data;
+        foreign[static_cast<size_t>(index)] ^= 3;
+
+        const std::string path = write_temp_file(foreign);
+
+        mem::file_module file(path.c_str());
+
+        unlink(path.c_str());
+
+        REQUIRE(!file);
+    }
+}
+#endif